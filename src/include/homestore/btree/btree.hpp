@@ -16,10 +16,13 @@
 #pragma once
 
 #include <atomic>
+#include <optional>
 #include <array>
 
 #include <boost/intrusive_ptr.hpp>
+#include <boost/fiber/fss.hpp>
 #include <folly/small_vector.h>
+#include <folly/synchronization/Rcu.h>
 #include <iomgr/fiber_lib.hpp>
 
 #include "btree_req.hpp"
@@ -35,19 +38,51 @@ typedef std::function< bool(const BtreeKey&, const BtreeValue&, const BtreeReque
 typedef std::function< bool(const BtreeKey&, const BtreeValue&, const BtreeRequest&) > on_kv_remove_t;
 typedef std::function< bool(const BtreeKey&, const BtreeKey&, const BtreeValue&, const BtreeRequest&) > on_kv_update_t;
 
+// Visitor of query results, called with the serialized key and value of each entry. Blobs point into the leaf, which is
+// read locked during the call, so they are valid only until the visitor returns.
+typedef std::function< void(const sisl::blob&, const sisl::blob&) > query_visitor_t;
+
 using BtreeNodePtr = boost::intrusive_ptr< BtreeNode >;
 
+// Nodes which a query keeps read locked across its pages (intrusive sweep and serializable queries), in key order.
+// These locks are owned by the query cursor and not by the thread, so they are released only when the query completes
+// or the cursor is destroyed.
+class BtreeQueryLockTracker : public BtreeLockTracker {
+public:
+    BtreeQueryLockTracker() = default;
+    BtreeQueryLockTracker(const BtreeQueryLockTracker&) = delete;
+    BtreeQueryLockTracker& operator=(const BtreeQueryLockTracker&) = delete;
+    ~BtreeQueryLockTracker() override { release(); }
+
+    void push(const BtreeNodePtr& node) { m_nodes.push_back(node); }
+    void release() {
+        for (auto& node : m_nodes) {
+            node->unlock(locktype_t::READ);
+        }
+        m_nodes.clear();
+        m_cur = 0;
+    }
+
+    std::vector< BtreeNodePtr > m_nodes;
+    uint32_t m_cur{0}; // Node from which the next page starts
+};
+
 struct BtreeThreadVariables {
     std::vector< btree_locked_node_info > wr_locked_nodes;
     std::vector< btree_locked_node_info > rd_locked_nodes;
     BtreeNodePtr force_split_node{nullptr};
+    btree_op_profile* op_profile{nullptr}; // Profile of the operation running on this fiber, if it is sampled
+    uint64_t num_ops{0};                   // Operations started on this fiber, to sample them for profiling
 };
 
 template < typename K, typename V >
 class Btree {
 private:
+    // Serializes root changes and whole tree operations. Regular put/get/remove/query do not take this lock, instead
+    // they lock the node published in m_root_node and validate it is still the root.
     mutable iomgr::FiberManagerLib::shared_mutex m_btree_lock;
     BtreeLinkInfo m_root_node_info;
+    mutable std::atomic< BtreeNode* > m_root_node{nullptr};
 
     BtreeMetrics m_metrics;
     std::atomic< bool > m_destroyed{false};
@@ -64,14 +99,44 @@ private:
 
     // This workaround of BtreeThreadVariables is needed instead of directly declaring statics
     // to overcome the gcc bug, pointer here: https://gcc.gnu.org/bugzilla/show_bug.cgi?id=66944
+    // Variables are kept in fiber local storage, which is looked up from the running fiber's own context and freed
+    // when the fiber exits.
     static BtreeThreadVariables* bt_thread_vars() {
-        auto this_id(boost::this_fiber::get_id());
-        static thread_local std::map< boost::fibers::fiber::id, std::unique_ptr< BtreeThreadVariables > > fiber_map;
-        if (fiber_map.count(this_id)) { return fiber_map[this_id].get(); }
-        fiber_map[this_id] = std::make_unique< BtreeThreadVariables >();
-        return fiber_map[this_id].get();
+        static boost::fibers::fiber_specific_ptr< BtreeThreadVariables > fiber_vars;
+        auto vars = fiber_vars.get();
+        if (sisl_unlikely(vars == nullptr)) {
+            vars = new BtreeThreadVariables();
+            fiber_vars.reset(vars);
+        }
+        return vars;
     }
 
+    // Profiles the operation if it is sampled: the time spent in each phase and the nodes visited are accumulated in
+    // the fiber local profile, which is observed into the metrics once the operation is done. It does not turn on
+    // route tracing, so that sampled operations still take the lock free paths.
+    class OpProfileScope {
+    public:
+        OpProfileScope(const Btree& bt) : m_bt{bt} {
+            auto const rate = bt.m_bt_cfg.m_op_profile_sample_rate;
+            if (rate == 0) { return; }
+
+            // Operation nested on the same fiber (say from a callback) is accounted as part of the outer one
+            auto vars = bt_thread_vars();
+            if ((vars->op_profile != nullptr) || ((++vars->num_ops % rate) != 0)) { return; }
+            vars->op_profile = &m_profile.emplace();
+        }
+
+        ~OpProfileScope() {
+            if (!m_profile) { return; }
+            m_bt.observe_op_profile(*m_profile);
+            bt_thread_vars()->op_profile = nullptr;
+        }
+
+    private:
+        const Btree& m_bt;
+        std::optional< btree_op_profile > m_profile;
+    };
+
 protected:
     BtreeConfig m_bt_cfg;
 
@@ -93,6 +158,19 @@ public:
 
     btree_status_t query(BtreeQueryRequest< K >& query_req, std::vector< std::pair< K, V > >& out_values) const;
 
+    // Query which hands each result to the visitor in place, instead of copying it out. Keys which the node does not
+    // keep contiguous are assembled in the arena, which the caller can pass to reuse its allocation across queries.
+    btree_status_t query(BtreeQueryRequest< K >& query_req, const query_visitor_t& visitor,
+                         std::vector< uint8_t >* arena = nullptr) const;
+
+    // Loads the kvs, sorted in ascending order of keys, into an empty btree by building it bottom up
+    btree_status_t bulk_load(const std::vector< std::pair< K, V > >& kvs, void* op_context);
+
+    // Same as above, but the sorted kvs are streamed from the range [first, last) in a single pass, so that they need
+    // not be collected upfront. Range could be of any pair like elements of K and V.
+    template < typename InputIt >
+    btree_status_t bulk_load(InputIt first, InputIt last, void* op_context);
+
     // bool verify_tree(bool update_debug_bm) const;
     virtual std::pair< btree_status_t, uint64_t > destroy_btree(void* context);
     nlohmann::json get_status(int log_level) const;
@@ -114,6 +192,20 @@ protected:
     virtual BtreeNode* init_node(uint8_t* node_buf, uint32_t node_ctx_size, bnodeid_t id, bool init_buf,
                                  bool is_leaf) const;
     virtual btree_status_t read_node_impl(bnodeid_t id, BtreeNodePtr& node) const = 0;
+
+    // Resolve the node for lock free traversal. It is called within a folly rcu reader section and should neither block
+    // nor read from the device. Node is handed out without a reference, so store which supports it is expected to
+    // defer reclaiming the memory of a freed node until the rcu readers which could have seen it are done.
+    virtual btree_status_t read_node_optimistic_impl(bnodeid_t id, BtreeNode*& node) const {
+        return btree_status_t::fast_path_not_possible;
+    }
+
+    // Whether the store can resolve nodes with read_node_optimistic_impl, so that gets can try the lock free traversal
+    virtual bool supports_optimistic_read() const { return false; }
+
+    // Hint to start reading the node in the background, since it is going to be read soon. Store which has the node
+    // in memory or cannot read asynchronously, can ignore it.
+    virtual void prefetch_node_impl(bnodeid_t id) const {}
     virtual btree_status_t write_node_impl(const BtreeNodePtr& node, void* context) = 0;
     virtual btree_status_t refresh_node(const BtreeNodePtr& node, bool for_read_modify_write, void* context) const = 0;
     virtual void free_node_impl(const BtreeNodePtr& node, void* context) = 0;
@@ -134,6 +226,12 @@ protected:
     /////////////////////////////// Internal Node Management Methods ////////////////////////////////////
     btree_status_t read_and_lock_node(bnodeid_t id, BtreeNodePtr& node_ptr, locktype_t int_lock_type,
                                       locktype_t leaf_lock_type, void* context) const;
+    btree_status_t read_and_lock_root(BtreeNodePtr& root, locktype_t int_lock_type, locktype_t leaf_lock_type,
+                                      void* context) const;
+    bool optimistic_descend(const BtreeKey& key, BtreeNodePtr& parent_node, uint64_t& parent_ver,
+                            BtreeLinkInfo& parent_link, BtreeNodePtr& leaf_node) const;
+    btree_status_t load_root_node() const;
+    void publish_root_node(const BtreeNodePtr& root) const;
     void read_node_or_fail(bnodeid_t id, BtreeNodePtr& node) const;
     btree_status_t write_node(const BtreeNodePtr& node, void* context);
     void free_node(const BtreeNodePtr& node, locktype_t cur_lock, void* context);
@@ -152,6 +250,10 @@ protected:
 
     std::pair< btree_status_t, uint64_t > do_destroy();
     void observe_lock_time(const BtreeNodePtr& node, locktype_t type, uint64_t time_spent) const;
+    void observe_op_profile(const btree_op_profile& profile) const;
+    btree_op_profile* op_profile() const {
+        return (m_bt_cfg.m_op_profile_sample_rate == 0) ? nullptr : bt_thread_vars()->op_profile;
+    }
 
     static void _start_of_lock(const BtreeNodePtr& node, locktype_t ltype, const char* fname, int line);
     static bool remove_locked_node(const BtreeNodePtr& node, locktype_t ltype, btree_locked_node_info* out_info);
@@ -186,6 +288,7 @@ protected:
     ///////// Mutate Impl Methods
     template < typename ReqT >
     btree_status_t do_put(const BtreeNodePtr& my_node, locktype_t curlock, ReqT& req);
+    btree_status_t do_put_optimistic(BtreeSinglePutRequest& req);
 
     template < typename ReqT >
     btree_status_t mutate_write_leaf_node(const BtreeNodePtr& my_node, ReqT& req);
@@ -196,11 +299,16 @@ protected:
     template < typename ReqT >
     bool is_split_needed(const BtreeNodePtr& node, const BtreeConfig& cfg, ReqT& req) const;
 
+    btree_status_t redistribute_to_left(const BtreeNodePtr& parent_node, const BtreeNodePtr& child_node,
+                                        uint32_t parent_ind, void* context);
     btree_status_t split_node(const BtreeNodePtr& parent_node, const BtreeNodePtr& child_node, uint32_t parent_ind,
                               BtreeKey* out_split_key, void* context);
     btree_status_t mutate_extents_in_leaf(const BtreeNodePtr& my_node, BtreeRangePutRequest< K >& rpreq);
     btree_status_t repair_split(const BtreeNodePtr& parent_node, const BtreeNodePtr& child_node1,
                                 uint32_t parent_split_idx, void* context);
+    template < typename InputIt >
+    btree_status_t do_bulk_load(InputIt first, InputIt last, std::vector< BtreeNodePtr >& new_nodes, uint64_t& num_kvs,
+                                void* context);
 
     ///////// Remove Impl Methods
     template < typename ReqT >
@@ -216,20 +324,57 @@ protected:
                                 uint32_t parent_merge_idx, void* context);
 
     ///////// Query Impl Methods
-    btree_status_t do_sweep_query(BtreeNodePtr& my_node, BtreeQueryRequest< K >& qreq,
-                                  std::vector< std::pair< K, V > >& out_values) const;
+    // Query output which passes the results to the visitor, tracking what the cursor needs in place of the out list
+    struct QueryVisitSink {
+        const query_visitor_t& visitor;
+        std::vector< uint8_t >& arena;
+        size_t count{0};
+        K last_key;
+
+        size_t size() const { return count; }
+    };
+
+    template < typename OutT >
+    btree_status_t do_query(BtreeQueryRequest< K >& qreq, OutT& out_values) const;
+    template < typename OutT >
+    btree_status_t do_sweep_query(BtreeNodePtr& my_node, BtreeQueryRequest< K >& qreq, OutT& out_values) const;
+    template < typename OutT >
     btree_status_t do_traversal_query(const BtreeNodePtr& my_node, BtreeQueryRequest< K >& qreq,
-                                      std::vector< std::pair< K, V > >& out_values) const;
-#ifdef SERIALIZABLE_QUERY_IMPLEMENTATION
-    btree_status_t do_serialzable_query(const BtreeNodePtr& my_node, BtreeSerializableQueryRequest& qreq,
-                                        std::vector< std::pair< K, V > >& out_values);
-    btree_status_t sweep_query(BtreeQueryRequest< K >& qreq, std::vector< std::pair< K, V > >& out_values);
-    btree_status_t serializable_query(BtreeSerializableQueryRequest& qreq,
-                                      std::vector< std::pair< K, V > >& out_values);
-#endif
+                                      OutT& out_values) const;
+    template < typename OutT >
+    btree_status_t do_reverse_sweep_query(const BtreeNodePtr& my_node, BtreeQueryRequest< K >& qreq,
+                                          OutT& out_values) const;
+    template < typename OutT >
+    void add_query_results(const BtreeNodePtr& node, uint32_t start_idx, uint32_t count, BtreeQueryRequest< K >& qreq,
+                           OutT& out_values, bool reverse = false) const;
+    void prefetch_sweep_leaves(const BtreeNodePtr& parent_node, uint32_t child_idx, const BtreeNodePtr& leaf_node,
+                               const BtreeQueryRequest< K >& qreq) const;
+    template < typename OutT >
+    btree_status_t do_intrusive_sweep_query(BtreeNodePtr& my_node, BtreeQueryRequest< K >& qreq,
+                                            OutT& out_values) const;
+    template < typename OutT >
+    btree_status_t do_serializable_query(BtreeNodePtr& my_node, BtreeQueryRequest< K >& qreq,
+                                         OutT& out_values) const;
+    btree_status_t lock_query_range(BtreeNodePtr& my_node, BtreeQueryRequest< K >& qreq) const;
+    static BtreeQueryLockTracker* query_lock_tracker(BtreeQueryRequest< K >& qreq);
+    static void release_query_locks(BtreeQueryRequest< K >& qreq);
 
     ///////// Get Impl Methods
     template < typename ReqT >
     btree_status_t do_get(const BtreeNodePtr& my_node, ReqT& greq) const;
+
+    template < typename ReqT >
+    btree_status_t do_get_optimistic(ReqT& greq) const;
+
+    // Only the fixed size interior layouts can be searched while writers are modifying the node
+    bool optimistic_read_possible() const {
+        return supports_optimistic_read() &&
+            ((m_bt_cfg.m_int_node_type == btree_node_type::FIXED) ||
+             (m_bt_cfg.m_int_node_type == btree_node_type::COMPACT));
+    }
+
+    btree_status_t do_multi_get(BtreeMultiGetRequest& greq) const;
+    btree_status_t do_multi_get(const BtreeNodePtr& my_node, BtreeMultiGetRequest& greq, uint32_t start,
+                                uint32_t end) const;
 };
 } // namespace homestore
@@ -15,6 +15,7 @@
  *********************************************************************************/
 #pragma once
 
+#include <algorithm>
 #include <functional>
 #include <memory>
 #include <string>
@@ -48,7 +49,9 @@ Btree< K, V >::Btree(const BtreeConfig& cfg, on_kv_read_t&& read_cb, on_kv_updat
 }
 
 template < typename K, typename V >
-Btree< K, V >::~Btree() = default;
+Btree< K, V >::~Btree() {
+    publish_root_node(nullptr);
+}
 
 template < typename K, typename V >
 btree_status_t Btree< K, V >::init(void* op_context) {
@@ -58,6 +61,7 @@ btree_status_t Btree< K, V >::init(void* op_context) {
 template < typename K, typename V >
 void Btree< K, V >::set_root_node_info(const BtreeLinkInfo& info) {
     m_root_node_info = info;
+    publish_root_node(nullptr); // Root node is loaded lazily upon first access
 }
 
 template < typename K, typename V >
@@ -72,6 +76,7 @@ std::pair< btree_status_t, uint64_t > Btree< K, V >::destroy_btree(void* context
     }
     ret = do_destroy(n_freed_nodes, context);
     if (ret == btree_status_t::success) {
+        publish_root_node(nullptr);
         BT_LOG(DEBUG, "btree(root: {}) {} nodes destroyed successfully", m_root_node_info.bnode_id(), n_freed_nodes);
     } else {
         m_destroyed = false;
@@ -84,14 +89,25 @@ std::pair< btree_status_t, uint64_t > Btree< K, V >::destroy_btree(void* context
 template < typename K, typename V >
 template < typename ReqT >
 btree_status_t Btree< K, V >::put(ReqT& put_req) {
-    static_assert(std::is_same_v< ReqT, BtreeSinglePutRequest > || std::is_same_v< ReqT, BtreeRangePutRequest< K > >,
+    static_assert(std::is_same_v< ReqT, BtreeSinglePutRequest > || std::is_same_v< ReqT, BtreeRangePutRequest< K > > ||
+                      std::is_same_v< ReqT, BtreeBatchPutRequest >,
                   "put api is called with non put request type");
     COUNTER_INCREMENT(m_metrics, btree_write_ops_count, 1);
+    OpProfileScope profile_scope{*this};
     auto acq_lock = locktype_t::READ;
     bool is_leaf = false;
 
-    m_btree_lock.lock_shared();
     btree_status_t ret = btree_status_t::success;
+    BtreeNodePtr root;
+
+    if constexpr (std::is_same_v< ReqT, BtreeBatchPutRequest >) {
+        BT_DBG_ASSERT(std::is_sorted(put_req.m_keys.cbegin(), put_req.m_keys.cend(),
+                                     [](const BtreeKey* a, const BtreeKey* b) { return a->compare(*b) < 0; }),
+                      "Keys of batch put are expected in ascending order");
+        put_req.m_statuses.assign(put_req.num_keys(), btree_status_t::put_failed);
+        put_req.m_cursor = 0;
+        if (put_req.num_keys() == 0) { return ret; }
+    }
 
 retry:
 #ifndef NDEBUG
@@ -99,22 +115,27 @@ retry:
 #endif
     BT_LOG_ASSERT_EQ(bt_thread_vars()->rd_locked_nodes.size(), 0);
     BT_LOG_ASSERT_EQ(bt_thread_vars()->wr_locked_nodes.size(), 0);
+    if constexpr (std::is_same_v< ReqT, BtreeBatchPutRequest >) { put_req.m_end = put_req.num_keys(); }
 
-    BtreeNodePtr root;
-    ret = read_and_lock_node(m_root_node_info.bnode_id(), root, acq_lock, acq_lock, put_req.m_op_context);
+    if constexpr (std::is_same_v< ReqT, BtreeSinglePutRequest >) {
+        // Lock free descent is not possible or nodes have changed underneath, fallback to lock coupling from the root
+        ret = do_put_optimistic(put_req);
+        if (ret == btree_status_t::retry) { goto retry; }
+        if (ret != btree_status_t::fast_path_not_possible) { goto out; }
+    }
+
+    ret = read_and_lock_root(root, acq_lock, acq_lock, put_req.m_op_context);
     if (ret != btree_status_t::success) { goto out; }
     is_leaf = root->is_leaf();
 
     if (is_split_needed(root, m_bt_cfg, put_req)) {
         // Time to do the split of root.
         unlock_node(root, acq_lock);
-        m_btree_lock.unlock_shared();
         ret = check_split_root(put_req);
         BT_LOG_ASSERT_EQ(bt_thread_vars()->rd_locked_nodes.size(), 0);
         BT_LOG_ASSERT_EQ(bt_thread_vars()->wr_locked_nodes.size(), 0);
 
         // We must have gotten a new root, need to start from scratch.
-        m_btree_lock.lock_shared();
         if (ret != btree_status_t::success) {
             LOGERROR("root split failed btree name {}", m_bt_cfg.name());
             goto out;
@@ -138,8 +159,15 @@ retry:
         }
     }
 
+    if constexpr (std::is_same_v< ReqT, BtreeBatchPutRequest >) {
+        if ((ret == btree_status_t::success) &&
+            std::any_of(put_req.m_statuses.cbegin(), put_req.m_statuses.cend(),
+                        [](btree_status_t s) { return s != btree_status_t::success; })) {
+            ret = btree_status_t::put_failed;
+        }
+    }
+
 out:
-    m_btree_lock.unlock_shared();
 #ifndef NDEBUG
     check_lock_debug();
 #endif
@@ -155,21 +183,28 @@ out:
 template < typename K, typename V >
 template < typename ReqT >
 btree_status_t Btree< K, V >::get(ReqT& greq) const {
-    static_assert(std::is_same_v< BtreeSingleGetRequest, ReqT > || std::is_same_v< BtreeGetAnyRequest< K >, ReqT >,
+    static_assert(std::is_same_v< BtreeSingleGetRequest, ReqT > || std::is_same_v< BtreeGetAnyRequest< K >, ReqT > ||
+                      std::is_same_v< BtreeMultiGetRequest, ReqT >,
                   "get api is called with non get request type");
 
+    OpProfileScope profile_scope{*this};
     btree_status_t ret = btree_status_t::success;
 
-    m_btree_lock.lock_shared();
     BtreeNodePtr root;
 
-    ret = read_and_lock_node(m_root_node_info.bnode_id(), root, locktype_t::READ, locktype_t::READ, greq.m_op_context);
-    if (ret != btree_status_t::success) { goto out; }
+    if constexpr (std::is_same_v< BtreeMultiGetRequest, ReqT >) {
+        ret = do_multi_get(greq);
+    } else {
+        ret = do_get_optimistic(greq);
+        if (ret != btree_status_t::fast_path_not_possible) { goto out; }
 
-    ret = do_get(root, greq);
-out:
-    m_btree_lock.unlock_shared();
+        // Lock free traversal is not possible or nodes have changed underneath, fallback to lock coupled traversal
+        ret = read_and_lock_root(root, locktype_t::READ, locktype_t::READ, greq.m_op_context);
+        if (ret != btree_status_t::success) { goto out; }
 
+        ret = do_get(root, greq);
+    }
+out:
 #ifndef NDEBUG
     check_lock_debug();
 #endif
@@ -184,27 +219,25 @@ btree_status_t Btree< K, V >::remove(ReqT& req) {
                       std::is_same_v< ReqT, BtreeRemoveAnyRequest< K > >,
                   "remove api is called with non remove request type");
 
+    OpProfileScope profile_scope{*this};
     locktype_t acq_lock = locktype_t::READ;
-    m_btree_lock.lock_shared();
 
 retry:
     btree_status_t ret = btree_status_t::success;
     BtreeNodePtr root;
-    ret = read_and_lock_node(m_root_node_info.bnode_id(), root, acq_lock, acq_lock, req.m_op_context);
+    ret = read_and_lock_root(root, acq_lock, acq_lock, req.m_op_context);
     if (ret != btree_status_t::success) { goto out; }
 
     if (root->total_entries() == 0) {
         if (root->is_leaf()) {
             // There are no entries in btree.
             unlock_node(root, acq_lock);
-            m_btree_lock.unlock_shared();
             ret = btree_status_t::not_found;
             goto out;
         }
 
         BT_NODE_LOG_ASSERT_EQ(root->has_valid_edge(), true, root, "Orphaned root with no entries and edge");
         unlock_node(root, acq_lock);
-        m_btree_lock.unlock_shared();
 
         ret = check_collapse_root(req);
         if (ret != btree_status_t::success && ret != btree_status_t::merge_not_required) {
@@ -213,7 +246,6 @@ retry:
         }
 
         // We must have gotten a new root, need to start from scratch.
-        m_btree_lock.lock_shared();
         goto retry;
     } else if (root->is_leaf() && (acq_lock != locktype_t::WRITE)) {
         // Root is a leaf, need to take write lock, instead of read, retry
@@ -228,7 +260,6 @@ retry:
             goto retry;
         }
     }
-    m_btree_lock.unlock_shared();
 
 out:
 #ifndef NDEBUG
@@ -239,44 +270,82 @@ out:
 
 template < typename K, typename V >
 btree_status_t Btree< K, V >::query(BtreeQueryRequest< K >& qreq, std::vector< std::pair< K, V > >& out_values) const {
+    return do_query(qreq, out_values);
+}
+
+template < typename K, typename V >
+btree_status_t Btree< K, V >::query(BtreeQueryRequest< K >& qreq, const query_visitor_t& visitor,
+                                    std::vector< uint8_t >* arena) const {
+    std::vector< uint8_t > local_arena;
+    QueryVisitSink sink{visitor, arena ? *arena : local_arena};
+    return do_query(qreq, sink);
+}
+
+template < typename K, typename V >
+template < typename OutT >
+btree_status_t Btree< K, V >::do_query(BtreeQueryRequest< K >& qreq, OutT& out_values) const {
     COUNTER_INCREMENT(m_metrics, btree_query_ops_count, 1);
 
     btree_status_t ret = btree_status_t::success;
     if (qreq.batch_size() == 0) { return ret; }
+    OpProfileScope profile_scope{*this};
 
-    m_btree_lock.lock_shared();
     BtreeNodePtr root = nullptr;
-    ret = read_and_lock_node(m_root_node_info.bnode_id(), root, locktype_t::READ, locktype_t::READ, qreq.m_op_context);
-    if (ret != btree_status_t::success) { goto out; }
+    if (query_lock_tracker(qreq) == nullptr) {
+        // Queries which resume from the nodes kept locked by previous page do not walk down from root again
+        ret = read_and_lock_root(root, locktype_t::READ, locktype_t::READ, qreq.m_op_context);
+        if (ret != btree_status_t::success) { goto out; }
+    }
 
     switch (qreq.query_type()) {
     case BtreeQueryType::SWEEP_NON_INTRUSIVE_PAGINATION_QUERY:
         ret = do_sweep_query(root, qreq, out_values);
         break;
 
+    case BtreeQueryType::SWEEP_INTRUSIVE_PAGINATION_QUERY:
+        ret = do_intrusive_sweep_query(root, qreq, out_values);
+        break;
+
+    case BtreeQueryType::SERIALIZABLE_QUERY:
+        ret = do_serializable_query(root, qreq, out_values);
+        break;
+
     case BtreeQueryType::TREE_TRAVERSAL_QUERY:
         ret = do_traversal_query(root, qreq, out_values);
         break;
 
+    case BtreeQueryType::SWEEP_NON_INTRUSIVE_PAGINATION_REVERSE_QUERY:
+        ret = do_reverse_sweep_query(root, qreq, out_values);
+        break;
+
     default:
         unlock_node(root, locktype_t::READ);
         LOGERROR("Query type {} is not supported yet", qreq.query_type());
         break;
     }
 
-    if ((qreq.query_type() == BtreeQueryType::SWEEP_NON_INTRUSIVE_PAGINATION_QUERY ||
-         qreq.query_type() == BtreeQueryType::TREE_TRAVERSAL_QUERY)) {
-        if (out_values.size()) {
-            K& out_last_key = out_values.back().first;
-            qreq.set_cursor_key(out_last_key);
-            if (out_last_key.compare(qreq.input_range().end_key()) >= 0) { ret = btree_status_t::success; }
+    if (out_values.size()) {
+        const K* out_last_key_ptr;
+        if constexpr (std::is_same_v< OutT, QueryVisitSink >) {
+            out_last_key_ptr = &out_values.last_key;
         } else {
-            DEBUG_ASSERT_NE(ret, btree_status_t::has_more, "Query returned has_more, but no values added")
+            out_last_key_ptr = &out_values.back().first;
         }
+        const K& out_last_key = *out_last_key_ptr;
+        qreq.set_cursor_key(out_last_key);
+        if (qreq.query_type() == BtreeQueryType::SWEEP_NON_INTRUSIVE_PAGINATION_REVERSE_QUERY) {
+            if (out_last_key.compare(qreq.input_range().start_key()) <= 0) { ret = btree_status_t::success; }
+        } else if (out_last_key.compare(qreq.input_range().end_key()) >= 0) {
+            ret = btree_status_t::success;
+        }
+    } else {
+        DEBUG_ASSERT_NE(ret, btree_status_t::has_more, "Query returned has_more, but no values added")
     }
 
+    // Nodes are kept locked for the next page only if there is one
+    if (ret != btree_status_t::has_more) { release_query_locks(qreq); }
+
 out:
-    m_btree_lock.unlock_shared();
 #ifndef NDEBUG
     check_lock_debug();
 #endif
@@ -288,6 +357,61 @@ out:
     return ret;
 }
 
+template < typename K, typename V >
+btree_status_t Btree< K, V >::bulk_load(const std::vector< std::pair< K, V > >& kvs, void* op_context) {
+    return bulk_load(kvs.cbegin(), kvs.cend(), op_context);
+}
+
+template < typename K, typename V >
+template < typename InputIt >
+btree_status_t Btree< K, V >::bulk_load(InputIt first, InputIt last, void* op_context) {
+    btree_status_t ret = btree_status_t::success;
+    BtreeNodePtr root;
+    std::vector< BtreeNodePtr > new_nodes;
+    uint64_t num_kvs{0};
+
+    // Root changes are serialized with btree lock, so the root read here remains the root
+    m_btree_lock.lock();
+    ret = read_and_lock_root(root, locktype_t::WRITE, locktype_t::WRITE, op_context);
+    if (ret != btree_status_t::success) { goto done; }
+
+    if (!root->is_leaf() || (root->total_entries() != 0)) {
+        BT_LOG(ERROR, "Bulk load is supported only on an empty btree");
+        unlock_node(root, locktype_t::WRITE);
+        ret = btree_status_t::not_supported;
+        goto done;
+    }
+
+    ret = do_bulk_load(first, last, new_nodes, num_kvs, op_context);
+    if ((ret != btree_status_t::success) || new_nodes.empty()) {
+        // Nothing is written yet, so dropping the nodes built so far leaves the btree empty as before
+        for (const auto& node : new_nodes) {
+            free_node(node, locktype_t::NONE, op_context);
+        }
+        unlock_node(root, locktype_t::WRITE);
+        if (ret != btree_status_t::success) { BT_LOG(ERROR, "Bulk load failed {} after {} kvs", ret, num_kvs); }
+        goto done;
+    }
+
+    // Nodes are handed to the store bottom up, which persists every parent only after the children it links (see
+    // do_bulk_load). New root is recorded right away, same as it is on a root split.
+    for (const auto& node : new_nodes) {
+        write_node(node, op_context);
+    }
+    m_root_node_info = new_nodes.back()->link_info();
+    publish_root_node(new_nodes.back());
+    update_new_root_info(m_root_node_info.bnode_id(), m_root_node_info.link_version());
+    COUNTER_INCREMENT(m_metrics, btree_depth, new_nodes.back()->level());
+    COUNTER_INCREMENT(m_metrics, btree_obj_count, num_kvs);
+
+    // Empty root leaf is replaced by the loaded tree, it is freed only after the new root is published
+    free_node(root, locktype_t::WRITE, op_context);
+
+done:
+    m_btree_lock.unlock();
+    return ret;
+}
+
 #if 0
 /**
  * @brief : verify btree is consistent and no corruption;
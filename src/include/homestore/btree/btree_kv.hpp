@@ -16,6 +16,7 @@
 #pragma once
 
 #include <string>
+#include <type_traits>
 #include <vector>
 #include <fmt/format.h>
 #include <sisl/fds/buffer.hpp>
@@ -64,6 +65,25 @@ public:
     virtual bool is_extent_key() const { return false; }
 };
 
+// Fixed size keys, whose serialized form is just an unsigned integer in native byte order and whose compare() is the
+// plain integer comparison, can advertise it by declaring "using integral_key_t = <unsigned integer type>". Fixed size
+// node layouts then search the raw key bytes directly, instead of constructing and comparing key objects per probe.
+template < typename K, typename = void >
+struct is_integral_btree_key : std::false_type {};
+
+template < typename K >
+struct is_integral_btree_key< K, std::void_t< typename K::integral_key_t > >
+        : std::bool_constant< std::is_unsigned_v< typename K::integral_key_t > > {};
+
+// Keys whose serialized bytes sort the same way as their compare() does, byte by byte with a key sorting ahead of the
+// longer keys it is a prefix of, can advertise it by declaring "using lexicographic_key_t = void". Prefix nodes then
+// compare them against the stored prefix and suffix bytes in place, instead of assembling and deserializing each key.
+template < typename K, typename = void >
+struct is_lexicographic_btree_key : std::false_type {};
+
+template < typename K >
+struct is_lexicographic_btree_key< K, std::void_t< typename K::lexicographic_key_t > > : std::true_type {};
+
 template < typename K >
 class BtreeTraversalState;
 
@@ -303,6 +323,21 @@ public:
         }
     }
 
+    // For descending queries, the cursor has the smallest key returned so far, so what remains is below it
+    const K& reverse_next_key() const {
+        return (m_cursor && m_cursor->m_last_key) ? *m_cursor->m_last_key : m_input_range.end_key();
+    }
+
+    const BtreeKeyRange< K >& reverse_next_range() {
+        if (m_cursor && m_cursor->m_last_key) {
+            m_next_range = BtreeKeyRange< K >(m_input_range.start_key(), m_input_range.is_start_inclusive(),
+                                              *m_cursor->m_last_key, false, m_input_range.multi_option());
+            return m_next_range;
+        } else {
+            return m_input_range;
+        }
+    }
+
 private:
     bool is_start_inclusive() const {
         // cursor always have the last key not included
@@ -69,6 +69,8 @@ public:
     const BtreeKeyRange< K >& working_range() const { return m_search_state.working_range(); }
 
     const K& next_key() const { return m_search_state.next_key(); }
+    const BtreeKeyRange< K >& reverse_next_range() { return m_search_state.reverse_next_range(); }
+    const K& reverse_next_key() const { return m_search_state.reverse_next_key(); }
     void trim_working_range(K&& end_key, bool end_incl) {
         m_search_state.trim_working_range(std::move(end_key), end_incl);
     }
@@ -115,6 +117,36 @@ public:
     const BtreeValue* m_newval;
 };
 
+// Batch of puts of keys given in ascending order, which need not be contiguous. All keys falling into the same leaf
+// are applied under a single write lock of the leaf and written once, instead of a descent per key. Put returns
+// success only if every key is applied, the outcome of each key is in status(i).
+struct BtreeBatchPutRequest : public BtreeRequest {
+public:
+    BtreeBatchPutRequest(btree_put_type put_type) : m_put_type{put_type} {}
+
+    void add(const BtreeKey* k, const BtreeValue* v, BtreeValue* existing_val = nullptr) {
+        m_keys.push_back(k);
+        m_vals.push_back(v);
+        m_existing_vals.push_back(existing_val);
+    }
+
+    uint32_t num_keys() const { return static_cast< uint32_t >(m_keys.size()); }
+    const BtreeKey& key(uint32_t i) const { return *m_keys[i]; }
+    const BtreeValue& value(uint32_t i) const { return *m_vals[i]; }
+    btree_status_t status(uint32_t i) const { return m_statuses[i]; }
+
+    const BtreeKey& next_key() const { return key(m_cursor); }
+    const BtreeValue& next_value() const { return value(m_cursor); }
+
+    std::vector< const BtreeKey* > m_keys;
+    std::vector< const BtreeValue* > m_vals;
+    std::vector< BtreeValue* > m_existing_vals;
+    const btree_put_type m_put_type;
+    std::vector< btree_status_t > m_statuses;
+    uint32_t m_cursor{0}; // First key which is yet to be applied
+    uint32_t m_end{0};    // End of the keys falling into the subtree being descended
+};
+
 /////////////////////////// 2: Remove Operations /////////////////////////////////////
 struct BtreeSingleRemoveRequest : public BtreeRequest {
 public:
@@ -169,6 +201,33 @@ public:
     BtreeValue* m_outval;
 };
 
+// Batch of point lookups resolved in a single walk of the tree. Keys are visited in sorted order and all keys which
+// fall under the same child are descended together, so each node on the way is read and locked once for the whole
+// batch. Get returns success only if every key is found, the outcome of each lookup is in status(i).
+struct BtreeMultiGetRequest : public BtreeRequest {
+public:
+    BtreeMultiGetRequest() = default;
+    BtreeMultiGetRequest(std::vector< const BtreeKey* >&& keys, std::vector< BtreeValue* >&& out_vals) :
+            m_keys{std::move(keys)}, m_outvals{std::move(out_vals)} {
+        DEBUG_ASSERT_EQ(m_keys.size(), m_outvals.size(), "Number of keys and out values of multi get differ");
+    }
+
+    void add(const BtreeKey* k, BtreeValue* out_val) {
+        m_keys.push_back(k);
+        m_outvals.push_back(out_val);
+    }
+
+    uint32_t num_keys() const { return static_cast< uint32_t >(m_keys.size()); }
+    const BtreeKey& key(uint32_t i) const { return *m_keys[i]; }
+    const BtreeValue& value(uint32_t i) const { return *m_outvals[i]; }
+    btree_status_t status(uint32_t i) const { return m_statuses[i]; }
+
+    std::vector< const BtreeKey* > m_keys;
+    std::vector< BtreeValue* > m_outvals;
+    std::vector< btree_status_t > m_statuses;
+    std::vector< uint32_t > m_sorted_order; // Indices into m_keys in key order, filled in by the btree
+};
+
 /////////////////////////// 4 Range Query Operations /////////////////////////////////////
 ENUM(BtreeQueryType, uint8_t,
      // This is default query which walks to first element in range, and then sweeps/walks
@@ -188,8 +247,15 @@ ENUM(BtreeQueryType, uint8_t,
 
      // This is both inefficient and quiet intrusive/unsafe query, where it locks the range
      // that is being queried for and do not allow any insert or update within that range. It
-     // essentially create a serializable level of isolation.
-     SERIALIZABLE_QUERY)
+     // essentially create a serializable level of isolation. All the leaves of the range are read
+     // locked on the first page and writers to them wait till the last page, so it fails if the
+     // range spans more leaves than BtreeConfig::m_max_query_locked_nodes.
+     SERIALIZABLE_QUERY,
+
+     // Same as sweep non intrusive query, except that it returns the entries in descending order of keys, starting
+     // from the end of the range. Leaves are walked right to left through their parents, as they are not linked to
+     // their previous sibling. Upon pagination, it walks down again from the key it left off.
+     SWEEP_NON_INTRUSIVE_PAGINATION_REVERSE_QUERY)
 
 template < typename K >
 struct BtreeQueryRequest : public BtreeRangeRequest< K > {
@@ -215,29 +281,4 @@ public:
     virtual ~BtreeLockTracker() = default;
 };
 
-#if 0
-class BtreeSweepQueryRequest : public BtreeQueryRequest {
-public:
-    BtreeSweepQueryRequest(const BtreeSearchRange& criteria, uint32_t iter_count = 1000,
-            const match_item_cb_t& match_item_cb = nullptr) :
-            BtreeQueryRequest(criteria, iter_count, match_item_cb) {}
-
-    BtreeSweepQueryRequest(const BtreeSearchRange &criteria, const match_item_cb_t& match_item_cb) :
-            BtreeQueryRequest(criteria, 1000, match_item_cb) {}
-
-    bool is_serializable() const { return false; }
-};
-
-class BtreeSerializableQueryRequest : public BtreeQueryRequest {
-public:
-    BtreeSerializableQueryRequest(const BtreeSearchRange &range, uint32_t iter_count = 1000,
-                             const match_item_cb_t& match_item_cb = nullptr) :
-            BtreeQueryRequest(range, iter_count, match_item_cb) {}
-
-    BtreeSerializableQueryRequest(const BtreeSearchRange &criteria, const match_item_cb_t& match_item_cb) :
-            BtreeSerializableQueryRequest(criteria, 1000, match_item_cb) {}
-
-    bool is_serializable() const { return true; }
-};
-#endif
 } // namespace homestore
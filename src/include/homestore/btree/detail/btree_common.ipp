@@ -293,6 +293,8 @@ template < typename K, typename V >
 void Btree< K, V >::append_route_trace(BtreeRequest& req, const BtreeNodePtr& node, btree_event_t event,
                                        uint32_t start_idx, uint32_t end_idx) const {
     if (req.route_tracing) {
+        auto const profile = op_profile();
+        auto const elapsed_ns = profile ? profile->elapsed_ns() : 0;
         req.route_tracing->emplace_back(trace_route_entry{.node_id = node->node_id(),
                                                           .node = node.get(),
                                                           .start_idx = start_idx,
@@ -300,7 +302,8 @@ void Btree< K, V >::append_route_trace(BtreeRequest& req, const BtreeNodePtr& no
                                                           .num_entries = node->total_entries(),
                                                           .level = node->level(),
                                                           .is_leaf = node->is_leaf(),
-                                                          .event = event});
+                                                          .event = event,
+                                                          .elapsed_ns = elapsed_ns});
     }
 }
 } // namespace homestore
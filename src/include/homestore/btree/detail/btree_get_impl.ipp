@@ -14,6 +14,8 @@
  *
  *********************************************************************************/
 #pragma once
+#include <algorithm>
+#include <numeric>
 #include <homestore/btree/btree.hpp>
 
 namespace homestore {
@@ -62,4 +64,133 @@ out:
     unlock_node(my_node, locktype_t::READ);
     return ret;
 }
+
+/*
+ * Lock free get: Interior nodes are traversed with optimistic lock coupling (see optimistic_descend) without taking
+ * their locks, and only the leaf is read locked, since its contents are handed out to the caller. Parent version is
+ * validated after the leaf lock is taken, which guarantees the leaf was linked for the key at that instant. Any
+ * concurrent modification fails the validation and the get falls back to lock coupling by returning
+ * fast_path_not_possible.
+ *
+ * It is tried only if the store supports it and the interior nodes can be searched lock free (fixed size layouts).
+ * Fallback is counted only when a validation fails, so the metric reflects contention with writers.
+ */
+template < typename K, typename V >
+template < typename ReqT >
+btree_status_t Btree< K, V >::do_get_optimistic(ReqT& greq) const {
+    if (!optimistic_read_possible() || greq.route_tracing) { return btree_status_t::fast_path_not_possible; }
+
+    const BtreeKey* key{nullptr};
+    if constexpr (std::is_same_v< BtreeGetAnyRequest< K >, ReqT >) {
+        key = &greq.m_range.start_key();
+    } else if constexpr (std::is_same_v< BtreeSingleGetRequest, ReqT >) {
+        key = &greq.key();
+    }
+
+    BtreeNodePtr parent_node;
+    BtreeNodePtr leaf_node;
+    uint64_t parent_ver{0};
+    BtreeLinkInfo parent_link;
+    if (!optimistic_descend(*key, parent_node, parent_ver, parent_link, leaf_node)) {
+        return btree_status_t::fast_path_not_possible;
+    }
+
+    // Leaf lock could block, so it is taken outside the rcu section and the parent is validated after that.
+    if (lock_node(leaf_node, locktype_t::READ, greq.m_op_context) == btree_status_t::success) {
+        if (parent_node->optimistic_read_validate(parent_ver)) { return do_get(leaf_node, greq); }
+        unlock_node(leaf_node, locktype_t::READ);
+    }
+
+    COUNTER_INCREMENT(m_metrics, btree_optimistic_read_fallbacks, 1);
+    return btree_status_t::fast_path_not_possible;
+}
+
+/*
+ * Multi get sorts the keys once and walks the tree with lock coupling, carrying the sorted run of keys [start, end)
+ * which falls under my_node. At an interior node the run is split into the sub runs going to each child, and every
+ * child is read locked and visited once for its whole sub run, while my_node stays locked until the last sub run is
+ * dispatched. Leaf resolves all its keys under a single read lock.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::do_multi_get(BtreeMultiGetRequest& greq) const {
+    auto const nkeys = greq.num_keys();
+    greq.m_statuses.assign(nkeys, btree_status_t::not_found);
+    if (nkeys == 0) { return btree_status_t::success; }
+
+    greq.m_sorted_order.resize(nkeys);
+    std::iota(greq.m_sorted_order.begin(), greq.m_sorted_order.end(), 0u);
+    std::sort(greq.m_sorted_order.begin(), greq.m_sorted_order.end(),
+              [&greq](uint32_t a, uint32_t b) { return greq.key(a).compare(greq.key(b)) < 0; });
+
+    BtreeNodePtr root;
+    auto ret = read_and_lock_root(root, locktype_t::READ, locktype_t::READ, greq.m_op_context);
+    if (ret != btree_status_t::success) { return ret; }
+
+    ret = do_multi_get(root, greq, 0, nkeys);
+    if ((ret == btree_status_t::success) &&
+        std::any_of(greq.m_statuses.cbegin(), greq.m_statuses.cend(),
+                    [](btree_status_t s) { return s != btree_status_t::success; })) {
+        ret = btree_status_t::not_found;
+    }
+    return ret;
+}
+
+template < typename K, typename V >
+btree_status_t Btree< K, V >::do_multi_get(const BtreeNodePtr& my_node, BtreeMultiGetRequest& greq, uint32_t start,
+                                           uint32_t end) const {
+    btree_status_t ret{btree_status_t::success};
+    bool found{false};
+    uint32_t idx;
+
+    if (my_node->is_leaf()) {
+        for (auto i{start}; i < end; ++i) {
+            auto const kidx = greq.m_sorted_order[i];
+            std::tie(found, idx) = my_node->find(greq.key(kidx), greq.m_outvals[kidx], true);
+            if (!found) { continue; }
+
+            greq.m_statuses[kidx] = btree_status_t::success;
+            call_on_read_kv_cb(my_node, idx, greq);
+            if (greq.route_tracing) { append_route_trace(greq, my_node, btree_event_t::READ, idx, idx); }
+        }
+        unlock_node(my_node, locktype_t::READ);
+        return ret;
+    }
+
+    bool unlocked_already{false};
+    auto i{start};
+    while (i < end) {
+        BtreeLinkInfo child_info;
+        std::tie(found, idx) = my_node->find(greq.key(greq.m_sorted_order[i]), &child_info, true);
+        ASSERT_IS_VALID_INTERIOR_CHILD_INDX(found, idx, my_node);
+
+        // Keys are sorted, so all the following keys up to the separator of this child go down the same child
+        auto group_end{i + 1};
+        if (idx == my_node->total_entries()) {
+            group_end = end;
+        } else {
+            while ((group_end < end) &&
+                   (my_node->compare_nth_key(greq.key(greq.m_sorted_order[group_end]), idx) >= 0)) {
+                ++group_end;
+            }
+        }
+        if (greq.route_tracing) { append_route_trace(greq, my_node, btree_event_t::READ, idx, idx); }
+
+        BtreeNodePtr child_node;
+        ret = read_and_lock_node(child_info.bnode_id(), child_node, locktype_t::READ, locktype_t::READ,
+                                 greq.m_op_context);
+        if (ret != btree_status_t::success) { break; }
+
+        if (group_end == end) {
+            // No more keys to dispatch from this node, release it before descending
+            unlock_node(my_node, locktype_t::READ);
+            unlocked_already = true;
+        }
+        ret = do_multi_get(child_node, greq, i, group_end);
+        if (ret != btree_status_t::success) { break; }
+        i = group_end;
+    }
+
+    if (!unlocked_already) { unlock_node(my_node, locktype_t::READ); }
+    return ret;
+}
 } // namespace homestore
@@ -194,8 +194,10 @@ namespace homestore {
 using bnodeid_t = uint64_t;
 static constexpr bnodeid_t empty_bnodeid = std::numeric_limits< bnodeid_t >::max();
 static constexpr uint16_t bt_init_crc_16 = 0x8005;
+static constexpr uint32_t bt_init_crc_32 = 0x12345678;
 
 VENUM(btree_node_type, uint32_t, FIXED = 0, VAR_VALUE = 1, VAR_KEY = 2, VAR_OBJECT = 3, PREFIX = 4, COMPACT = 5)
+VENUM(btree_checksum_type, uint8_t, NONE = 0, CRC16_T10DIF = 1, CRC32C = 2, FARMHASH = 3)
 
 #ifdef USE_STORE_TYPE
 VENUM(btree_store_type, uint8_t, MEM = 0, SSD = 1)
@@ -217,6 +219,8 @@ void intrusive_ptr_add_ref(BtreeNode* node);
 void intrusive_ptr_release(BtreeNode* node);
 
 ENUM(btree_event_t, uint8_t, READ, MUTATE, REMOVE, SPLIT, REPAIR, MERGE);
+ENUM(btree_op_phase_t, uint8_t, LOCK_WAIT, NODE_READ, NODE_WRITE, SPLIT, MERGE);
+static constexpr uint32_t num_btree_op_phases{5};
 
 struct trace_route_entry {
     bnodeid_t node_id{empty_bnodeid};
@@ -227,11 +231,12 @@ struct trace_route_entry {
     uint16_t level{0};
     bool is_leaf{false};
     btree_event_t event{btree_event_t::READ};
+    uint64_t elapsed_ns{0}; // Time since the start of the operation, when it is profiled
 
     std::string to_string() const {
-        return fmt::format("[level={} {} event={} id={} ptr={} start_idx={} end_idx={} entries={}]", level,
-                           (is_leaf ? "LEAF" : "INTERIOR"), enum_name(event), node_id, (void*)node, start_idx, end_idx,
-                           num_entries);
+        return fmt::format("[level={} {} event={} id={} ptr={} start_idx={} end_idx={} entries={} elapsed_ns={}]",
+                           level, (is_leaf ? "LEAF" : "INTERIOR"), enum_name(event), node_id, (void*)node, start_idx,
+                           end_idx, num_entries, elapsed_ns);
     }
 };
 
@@ -242,11 +247,15 @@ struct BtreeConfig {
     uint8_t m_suggested_min_pct{30};
     uint8_t m_split_pct{50};
     uint32_t m_max_merge_nodes{3};
-    bool m_rebalance_turned_on{false};
+    bool m_rebalance_turned_on{false}; // Rebalance siblings on merge and move entries to left sibling before split
     bool m_merge_turned_on{true};
+    uint32_t m_max_query_prefetch_nodes{8}; // Max leaves a sweep query reads ahead of the one it is on, 0 disables
+    uint32_t m_max_query_locked_nodes{1024}; // Max leaves a serializable query can lock, 0 for no limit
+    uint32_t m_op_profile_sample_rate{0};   // Profile the phases of 1 in every N operations, 0 disables
 
     btree_node_type m_leaf_node_type{btree_node_type::VAR_OBJECT};
     btree_node_type m_int_node_type{btree_node_type::VAR_KEY};
+    btree_checksum_type m_checksum_type{btree_checksum_type::CRC32C}; // Checksum of persisted nodes, set on flush
     std::string m_btree_name; // Unique name for the btree
 
 private:
@@ -302,6 +311,7 @@ public:
         REGISTER_COUNTER(btree_split_count, "Total number of btree node splits");
         REGISTER_COUNTER(insert_failed_count, "Total number of inserts failed");
         REGISTER_COUNTER(btree_merge_count, "Total number of btree node merges");
+        REGISTER_COUNTER(btree_redistribute_count, "Total number of btree node redistributions instead of split");
         REGISTER_COUNTER(btree_depth, "Depth of btree", _publish_as::publish_as_gauge);
 
         REGISTER_COUNTER(btree_int_node_writes, "Total number of btree interior node writes", "btree_node_writes",
@@ -323,6 +333,7 @@ public:
         REGISTER_COUNTER(btree_write_ops_count, "number of btree operations");
         REGISTER_COUNTER(btree_query_ops_count, "number of btree operations");
         REGISTER_COUNTER(btree_remove_ops_count, "number of btree operations");
+        REGISTER_COUNTER(btree_optimistic_read_fallbacks, "number of lock free reads fallen back to locked reads");
         REGISTER_HISTOGRAM(btree_exclusive_time_in_int_node,
                            "Exclusive time spent (Write locked) on interior node (ns)", "btree_exclusive_time_in_node",
                            {"node_type", "interior"});
@@ -333,6 +344,22 @@ public:
         REGISTER_HISTOGRAM(btree_inclusive_time_in_leaf_node, "Inclusive time spent (Read locked) on leaf node (ns)",
                            "btree_inclusive_time_in_node", {"node_type", "leaf"});
 
+        REGISTER_COUNTER(btree_profiled_ops_count, "number of btree operations sampled for profiling");
+        REGISTER_HISTOGRAM(btree_op_latency, "Latency of the profiled operations (ns)", "btree_op_phase_time",
+                           {"phase", "total"});
+        REGISTER_HISTOGRAM(btree_op_lock_wait_time, "Time profiled operations waited for node locks (ns)",
+                           "btree_op_phase_time", {"phase", "lock_wait"});
+        REGISTER_HISTOGRAM(btree_op_node_read_time, "Time profiled operations spent reading nodes (ns)",
+                           "btree_op_phase_time", {"phase", "node_read"});
+        REGISTER_HISTOGRAM(btree_op_node_write_time, "Time profiled operations spent writing nodes (ns)",
+                           "btree_op_phase_time", {"phase", "node_write"});
+        REGISTER_HISTOGRAM(btree_op_split_time, "Time profiled operations spent splitting nodes (ns)",
+                           "btree_op_phase_time", {"phase", "split"});
+        REGISTER_HISTOGRAM(btree_op_merge_time, "Time profiled operations spent merging nodes (ns)",
+                           "btree_op_phase_time", {"phase", "merge"});
+        REGISTER_HISTOGRAM(btree_op_route_length, "Number of nodes visited by the profiled operations",
+                           "btree_op_route_length", {"op", "profiled"}, HistogramBucketsType(LinearUpto128Buckets));
+
         register_me_to_farm();
     }
 
@@ -0,0 +1,126 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace homestore {
+
+/*
+ * Search kernels for nodes which store unsigned integral keys in a sorted array of fixed size entries, with the key at
+ * the start of each entry (in native byte order). Search narrows the range down with a branch free binary search and
+ * then counts the keys less than the search key within a small window using vector compares. Vector kernel is chosen
+ * at compile time (AVX2 gathers, SSE2 compares for 32 bit keys), with a scalar fallback for everything else. Keys
+ * packed back to back (stride same as key size) are loaded directly instead of gathered.
+ */
+namespace key_search {
+static constexpr uint32_t linear_window{16};
+
+template < typename T >
+inline T key_at(const uint8_t* base, uint32_t stride, uint32_t idx) {
+    T k;
+    std::memcpy(&k, base + (size_t(stride) * idx), sizeof(T));
+    return k;
+}
+
+// Returns number of entries in [start, start + count) whose key is less than the search key
+template < typename T >
+inline uint32_t count_less(const uint8_t* base, uint32_t stride, uint32_t start, uint32_t count, T key) {
+    static_assert(std::is_unsigned_v< T >, "Integral key search is only for unsigned keys");
+    uint32_t i{0};
+    uint32_t less{0};
+    const uint8_t* window = base + (size_t(stride) * start);
+
+    // Vector compares are signed, so both sides are biased by the sign bit to get the unsigned ordering
+#if defined(__AVX2__)
+    if constexpr (sizeof(T) == sizeof(uint32_t)) {
+        auto const bias = _mm256_set1_epi32(std::numeric_limits< int32_t >::min());
+        auto const vkey = _mm256_xor_si256(_mm256_set1_epi32(int32_t(key)), bias);
+        auto const voffsets =
+            _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(int32_t(stride)));
+        for (; (i + 8) <= count; i += 8) {
+            auto const p = window + (size_t(stride) * i);
+            auto const vkeys = _mm256_xor_si256(
+                (stride == sizeof(T)) ? _mm256_loadu_si256(reinterpret_cast< const __m256i* >(p))
+                                      : _mm256_i32gather_epi32(reinterpret_cast< const int* >(p), voffsets, 1),
+                bias);
+            auto const mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(vkey, vkeys)));
+            less += std::popcount(uint32_t(mask));
+        }
+    } else if constexpr (sizeof(T) == sizeof(uint64_t)) {
+        auto const bias = _mm256_set1_epi64x(std::numeric_limits< int64_t >::min());
+        auto const vkey = _mm256_xor_si256(_mm256_set1_epi64x(int64_t(key)), bias);
+        auto const voffsets = _mm256_setr_epi64x(0, int64_t(stride), 2 * int64_t(stride), 3 * int64_t(stride));
+        for (; (i + 4) <= count; i += 4) {
+            auto const p = window + (size_t(stride) * i);
+            auto const vkeys = _mm256_xor_si256(
+                (stride == sizeof(T)) ? _mm256_loadu_si256(reinterpret_cast< const __m256i* >(p))
+                                      : _mm256_i64gather_epi64(reinterpret_cast< const long long* >(p), voffsets, 1),
+                bias);
+            auto const mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(vkey, vkeys)));
+            less += std::popcount(uint32_t(mask));
+        }
+    }
+#elif defined(__SSE2__)
+    if constexpr (sizeof(T) == sizeof(uint32_t)) {
+        auto const bias = _mm_set1_epi32(std::numeric_limits< int32_t >::min());
+        auto const vkey = _mm_xor_si128(_mm_set1_epi32(int32_t(key)), bias);
+        for (; (i + 4) <= count; i += 4) {
+            auto const vkeys =
+                _mm_xor_si128((stride == sizeof(T))
+                                  ? _mm_loadu_si128(reinterpret_cast< const __m128i* >(window + (sizeof(T) * i)))
+                                  : _mm_setr_epi32(int32_t(key_at< T >(window, stride, i)),
+                                                   int32_t(key_at< T >(window, stride, i + 1)),
+                                                   int32_t(key_at< T >(window, stride, i + 2)),
+                                                   int32_t(key_at< T >(window, stride, i + 3))),
+                              bias);
+            auto const mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(vkey, vkeys)));
+            less += std::popcount(uint32_t(mask));
+        }
+    }
+#endif
+
+    for (; i < count; ++i) {
+        less += (key_at< T >(window, stride, i) < key) ? 1 : 0;
+    }
+    return less;
+}
+
+// Returns whether the key is found and the index of the first entry whose key is not less than the search key
+template < typename T >
+inline std::pair< bool, uint32_t > lower_bound(const uint8_t* base, uint32_t stride, uint32_t nentries, T key) {
+    uint32_t first{0};
+    uint32_t len{nentries};
+    while (len > linear_window) {
+        uint32_t const half = len / 2;
+        first = (key_at< T >(base, stride, first + half - 1) < key) ? (first + half) : first;
+        len -= half;
+    }
+
+    uint32_t const idx = first + count_less< T >(base, stride, first, len, key);
+    return std::make_pair((idx < nentries) && (key_at< T >(base, stride, idx) == key), idx);
+}
+} // namespace key_search
+} // namespace homestore
@@ -46,6 +46,10 @@ btree_status_t Btree< K, V >::do_put(const BtreeNodePtr& my_node, locktype_t cur
         return ret;
     }
 
+    // For batch put, keys from the cursor upto subtree_end are the ones which fall within this subtree
+    [[maybe_unused]] uint32_t subtree_end{0};
+    if constexpr (std::is_same_v< ReqT, BtreeBatchPutRequest >) { subtree_end = req.m_end; }
+
 retry:
     uint32_t start_idx{0};
     uint32_t end_idx{0};
@@ -62,6 +66,13 @@ retry:
         auto const [found, idx] = my_node->find(req.key(), nullptr, true);
         ASSERT_IS_VALID_INTERIOR_CHILD_INDX(found, idx, my_node);
         end_idx = start_idx = idx;
+    } else if constexpr (std::is_same_v< ReqT, BtreeBatchPutRequest >) {
+        auto const [start_found, sidx] = my_node->find(req.next_key(), nullptr, true);
+        ASSERT_IS_VALID_INTERIOR_CHILD_INDX(start_found, sidx, my_node);
+        auto const [end_found, eidx] = my_node->find(req.key(subtree_end - 1), nullptr, true);
+        ASSERT_IS_VALID_INTERIOR_CHILD_INDX(end_found, eidx, my_node);
+        start_idx = sidx;
+        end_idx = eidx;
     }
 
     BT_NODE_DBG_ASSERT((curlock == locktype_t::READ || curlock == locktype_t::WRITE), my_node, "unexpected locktype {}",
@@ -127,6 +138,19 @@ retry:
                 ret = repair_split(my_node, child_node, curr_idx, req.m_op_context);
 
             } else {
+                if (m_bt_cfg.m_rebalance_turned_on && (curr_idx > 0)) {
+                    ret = redistribute_to_left(my_node, child_node, curr_idx, req.m_op_context);
+                    if (ret == btree_status_t::success) {
+                        // Child is replaced as part of redistribution, so walk down again to the new one
+                        if (req.route_tracing) { append_route_trace(req, child_node, btree_event_t::MERGE); }
+                        COUNTER_INCREMENT(m_metrics, btree_redistribute_count, 1);
+                        goto retry;
+                    } else if (ret != btree_status_t::merge_not_required) {
+                        child_cur_lock = locktype_t::NONE; // Child is not locked back on failure
+                        goto out;
+                    }
+                }
+
                 K split_key;
                 BT_NODE_LOG(TRACE, my_node, "Split node needed");
                 ret = split_node(my_node, child_node, curr_idx, &split_key, req.m_op_context);
@@ -159,6 +183,18 @@ retry:
             }
         }
 
+        // Narrow down the batch to the keys which fall under this child
+        if constexpr (std::is_same_v< ReqT, BtreeBatchPutRequest >) {
+            if (curr_idx == my_node->total_entries()) {
+                req.m_end = subtree_end;
+            } else {
+                req.m_end = req.m_cursor + 1;
+                while ((req.m_end < subtree_end) && (my_node->compare_nth_key(req.key(req.m_end), curr_idx) >= 0)) {
+                    ++req.m_end;
+                }
+            }
+        }
+
 #ifndef NDEBUG
         K ckey, pkey;
         if (curr_idx != my_node->total_entries()) { // not edge
@@ -192,7 +228,13 @@ retry:
         ret = do_put(child_node, child_cur_lock, req);
         if (ret != btree_status_t::success) { goto out; }
 
-        ++curr_idx;
+        if constexpr (std::is_same_v< ReqT, BtreeBatchPutRequest >) {
+            // Skip over the children which none of the remaining keys fall into
+            if (req.m_cursor == subtree_end) { break; }
+            curr_idx = my_node->find(req.next_key(), nullptr, true).second;
+        } else {
+            ++curr_idx;
+        }
     }
 out:
     if (curlock != locktype_t::NONE) { unlock_node(my_node, curlock); }
@@ -201,6 +243,44 @@ out:
     // have been unlocked by the recursive function and it could also been deleted.
 }
 
+/*
+ * Single put descends lock free (see optimistic_descend) down to the parent of the leaf, which is the deepest node it
+ * could have to modify other than the leaf, if the leaf needs a split. Parent is read locked and validated against the
+ * version sampled during the descent, and the put continues with lock coupling from there, exactly as it would have
+ * from the root. If the parent itself needs a split or repair, or any validation fails, it returns
+ * fast_path_not_possible and the put is done from the root.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::do_put_optimistic(BtreeSinglePutRequest& req) {
+    // Node forced to split is picked up by the put from the root, which should see it first
+    if (!optimistic_read_possible() || req.route_tracing || bt_thread_vars()->force_split_node) {
+        return btree_status_t::fast_path_not_possible;
+    }
+
+    BtreeNodePtr parent_node;
+    BtreeNodePtr leaf_node;
+    uint64_t parent_ver{0};
+    BtreeLinkInfo parent_link;
+    if (!optimistic_descend(req.key(), parent_node, parent_ver, parent_link, leaf_node)) {
+        return btree_status_t::fast_path_not_possible;
+    }
+    leaf_node.reset(); // Leaf is locked and resolved again by do_put from its parent
+
+    if (lock_node(parent_node, locktype_t::READ, req.m_op_context) != btree_status_t::success) {
+        return btree_status_t::fast_path_not_possible;
+    }
+    if (!parent_node->optimistic_read_validate(parent_ver)) {
+        unlock_node(parent_node, locktype_t::READ);
+        COUNTER_INCREMENT(m_metrics, btree_optimistic_read_fallbacks, 1);
+        return btree_status_t::fast_path_not_possible;
+    }
+    if (is_split_needed(parent_node, m_bt_cfg, req) || is_repair_needed(parent_node, parent_link)) {
+        unlock_node(parent_node, locktype_t::READ);
+        return btree_status_t::fast_path_not_possible;
+    }
+    return do_put(parent_node, locktype_t::READ, req);
+}
+
 template < typename K, typename V >
 template < typename ReqT >
 btree_status_t Btree< K, V >::mutate_write_leaf_node(const BtreeNodePtr& my_node, ReqT& req) {
@@ -245,6 +325,20 @@ btree_status_t Btree< K, V >::mutate_write_leaf_node(const BtreeNodePtr& my_node
             ret = btree_status_t::put_failed;
         }
         COUNTER_INCREMENT(m_metrics, btree_obj_count, 1);
+    } else if constexpr (std::is_same_v< ReqT, BtreeBatchPutRequest >) {
+        // Apply all the keys of the batch which fall into this leaf, until the leaf needs a split
+        auto const first = req.m_cursor;
+        while (req.m_cursor < req.m_end) {
+            if ((req.m_cursor != first) && is_split_needed(my_node, m_bt_cfg, req)) {
+                ret = btree_status_t::has_more;
+                break;
+            }
+            auto const i = req.m_cursor++;
+            req.m_statuses[i] = my_node->put(req.key(i), req.value(i), req.m_put_type, req.m_existing_vals[i])
+                ? btree_status_t::success
+                : btree_status_t::put_failed;
+        }
+        COUNTER_INCREMENT(m_metrics, btree_obj_count, req.m_cursor - first);
     }
 
     if ((ret == btree_status_t::success) || (ret == btree_status_t::has_more)) {
@@ -426,8 +520,9 @@ btree_status_t Btree< K, V >::check_split_root(ReqT& req) {
     BtreeNodePtr root;
     BtreeNodePtr new_root;
 
+    // Root changes are serialized with btree lock, so the root read here remains the root
     m_btree_lock.lock();
-    ret = read_and_lock_node(m_root_node_info.bnode_id(), root, locktype_t::WRITE, locktype_t::WRITE, req.m_op_context);
+    ret = read_and_lock_root(root, locktype_t::WRITE, locktype_t::WRITE, req.m_op_context);
     if (ret != btree_status_t::success) { goto done; }
 
     if (!is_split_needed(root, m_bt_cfg, req) && !is_repair_needed(root, m_root_node_info)) {
@@ -470,6 +565,7 @@ btree_status_t Btree< K, V >::check_split_root(ReqT& req) {
         if (req.route_tracing) { append_route_trace(req, child_node, btree_event_t::SPLIT); }
 
         m_root_node_info = BtreeLinkInfo{root->node_id(), root->link_version()};
+        publish_root_node(root);
         unlock_node(child_node, locktype_t::WRITE);
         COUNTER_INCREMENT(m_metrics, btree_depth, 1);
         update_new_root_info(root->node_id(), root->link_version());
@@ -483,6 +579,7 @@ done:
 template < typename K, typename V >
 btree_status_t Btree< K, V >::split_node(const BtreeNodePtr& parent_node, const BtreeNodePtr& child_node,
                                          uint32_t parent_ind, BtreeKey* out_split_key, void* context) {
+    btree_op_phase_timer timer{op_profile(), btree_op_phase_t::SPLIT};
     BtreeNodePtr child_node1 = child_node;
     BtreeNodePtr child_node2;
     child_node2.reset(child_node1->is_leaf() ? alloc_leaf_node().get() : alloc_interior_node().get());
@@ -549,6 +646,53 @@ btree_status_t Btree< K, V >::split_node(const BtreeNodePtr& parent_node, const
     return ret;
 }
 
+/*
+ * Redistribution before split: Instead of splitting the child, move its leading entries to the left sibling if the
+ * two of them can share the entries with room to spare. It is the rebalance of two nodes done by merge, which fills
+ * the left node in place and copies the rest of the child to a new node, so the node write ordering stays same as
+ * that of merge. Nodes of a level are always locked left to right, so the child is unlocked before locking the
+ * sibling and merge locks it back. Parent is write locked throughout, so the child cannot change in the meantime.
+ *
+ * Returns success if redistributed, in which case the child is freed. On merge_not_required, the child is locked back
+ * for the caller to split it. On any other failure, the child is left unlocked.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::redistribute_to_left(const BtreeNodePtr& parent_node, const BtreeNodePtr& child_node,
+                                                   uint32_t parent_ind, void* context) {
+    const auto child_size = child_node->occupied_size(m_bt_cfg);
+    unlock_node(child_node, locktype_t::WRITE);
+
+    BtreeLinkInfo left_info;
+    BtreeNodePtr left_node;
+    auto ret = get_child_and_lock_node(parent_node, parent_ind - 1, left_info, left_node, locktype_t::WRITE,
+                                       locktype_t::WRITE, context);
+    if (ret == btree_status_t::success) {
+        // Both nodes after the move should be left with as much room as the ideal fill keeps in a node, else the child
+        // would need a split soon after and this move is wasted.
+        const auto left_size = left_node->occupied_size(m_bt_cfg);
+        const auto balanced_size = (left_size + child_size + 1) / 2;
+        const auto room = m_bt_cfg.node_data_size() - m_bt_cfg.ideal_fill_size();
+        if ((left_size < child_size) && (balanced_size + room <= m_bt_cfg.ideal_fill_size()) &&
+            !is_repair_needed(left_node, left_info)) {
+            BT_NODE_LOG(TRACE, parent_node, "Redistribute child_idx={} to left sibling, sizes left={} child={}",
+                        parent_ind, left_size, child_size);
+            ret = merge_nodes(parent_node, left_node, parent_ind - 1, parent_ind, context);
+        } else {
+            ret = btree_status_t::merge_not_required;
+        }
+        unlock_node(left_node, locktype_t::WRITE);
+    } else {
+        ret = (ret == btree_status_t::not_found) ? btree_status_t::retry : ret;
+    }
+
+    if ((ret != btree_status_t::success) && (ret != btree_status_t::merge_not_required)) { return ret; }
+    if (ret == btree_status_t::merge_not_required) {
+        auto const lock_ret = lock_node(child_node, locktype_t::WRITE, context);
+        if (lock_ret != btree_status_t::success) { return lock_ret; }
+    }
+    return ret;
+}
+
 template < typename K, typename V >
 template < typename ReqT >
 bool Btree< K, V >::is_split_needed(const BtreeNodePtr& node, const BtreeConfig& cfg, ReqT& req) const {
@@ -576,6 +720,8 @@ bool Btree< K, V >::is_split_needed(const BtreeNodePtr& node, const BtreeConfig&
         }
     } else if constexpr (std::is_same_v< ReqT, BtreeSinglePutRequest >) {
         size_needed = req.key().serialized_size() + req.value().serialized_size() + node->get_record_size();
+    } else if constexpr (std::is_same_v< ReqT, BtreeBatchPutRequest >) {
+        size_needed = req.next_key().serialized_size() + req.next_value().serialized_size() + node->get_record_size();
     }
     int64_t alreadyFilledSize = cfg.node_data_size() - node->available_size(cfg);
     return (alreadyFilledSize + size_needed >= cfg.ideal_fill_size());
@@ -589,6 +735,93 @@ btree_status_t Btree< K, V >::repair_split(const BtreeNodePtr& parent_node, cons
     return write_node(parent_node, context);
 }
 
+/*
+ * Bulk load packs the sorted kvs into leaves chained left to right, each filled upto the ideal fill size, and then
+ * builds every interior level out of the last keys of the level below, until a single node is left which is the root.
+ * Like after splits, all but the rightmost node of a level carry a separator key for every child, while the rightmost
+ * one links its last child as the edge. Kvs are consumed in a single pass as they are packed. All the nodes are new,
+ * built here and appended to new_nodes bottom up, it is the caller which writes them. Every child is prepared as part
+ * of a node txn with the parent which links it, so that the store persists the parent only after all its children.
+ */
+template < typename K, typename V >
+template < typename InputIt >
+btree_status_t Btree< K, V >::do_bulk_load(InputIt first, InputIt last, std::vector< BtreeNodePtr >& new_nodes,
+                                           uint64_t& num_kvs, void* context) {
+    if (first == last) { return btree_status_t::success; }
+
+    auto const is_filled = [this](const BtreeNodePtr& node, uint32_t size_needed) {
+        auto const filled_size = m_bt_cfg.node_data_size() - node->available_size(m_bt_cfg);
+        return (node->total_entries() != 0) && ((filled_size + size_needed) >= m_bt_cfg.ideal_fill_size());
+    };
+
+    auto const alloc_level_node = [this, &new_nodes](uint16_t level) {
+        BtreeNodePtr n = (level == 0) ? alloc_leaf_node() : alloc_interior_node();
+        if (n) {
+            n->set_level(level);
+            new_nodes.push_back(n);
+        }
+        return n;
+    };
+
+    // Every node of the level built so far along with its last key
+    std::vector< std::pair< K, BtreeNodePtr > > level_nodes;
+    BtreeNodePtr node = alloc_level_node(0u);
+    if (node == nullptr) { return btree_status_t::space_not_avail; }
+    btree_status_t ret;
+
+    for (; first != last; ++first) {
+        const auto& kv = *first;
+        BT_DBG_ASSERT((node->total_entries() == 0) || (node->get_last_key< K >().compare(kv.first) < 0),
+                      "Keys of bulk load are expected in ascending order");
+        auto const size_needed = kv.first.serialized_size() + kv.second.serialized_size() + node->get_record_size();
+        if (is_filled(node, size_needed)) {
+            BtreeNodePtr next_node = alloc_level_node(0u);
+            if (next_node == nullptr) { return btree_status_t::space_not_avail; }
+            node->set_next_bnode(next_node->node_id());
+            level_nodes.emplace_back(node->get_last_key< K >(), node);
+            node = std::move(next_node);
+        }
+        ret = node->insert(node->total_entries(), kv.first, kv.second);
+        if (ret != btree_status_t::success) { return ret; }
+        ++num_kvs;
+    }
+    level_nodes.emplace_back(node->get_last_key< K >(), node);
+
+    for (uint16_t level{1}; level_nodes.size() > 1; ++level) {
+        std::vector< std::pair< K, BtreeNodePtr > > parent_nodes;
+        node = alloc_level_node(level);
+        if (node == nullptr) { return btree_status_t::space_not_avail; }
+
+        for (size_t i{0}; i < level_nodes.size(); ++i) {
+            auto const& key = level_nodes[i].first;
+            auto const& child = level_nodes[i].second;
+            if (i == level_nodes.size() - 1) {
+                node->set_edge_value(child->link_info());
+            } else {
+                auto const size_needed =
+                    key.serialized_size() + BtreeLinkInfo::get_fixed_size() + node->get_record_size();
+                if (is_filled(node, size_needed)) {
+                    BtreeNodePtr next_node = alloc_level_node(level);
+                    if (next_node == nullptr) { return btree_status_t::space_not_avail; }
+                    node->set_next_bnode(next_node->node_id());
+                    parent_nodes.emplace_back(node->get_last_key< K >(), node);
+                    node = std::move(next_node);
+                }
+                ret = node->insert(node->total_entries(), key, child->link_info());
+                if (ret != btree_status_t::success) { return ret; }
+            }
+
+            ret = prepare_node_txn(node, child, context);
+            if (ret != btree_status_t::success) { return ret; }
+        }
+
+        // Key of the rightmost node is never used, since it is linked as the edge of its parent or is the root
+        parent_nodes.emplace_back(K{}, node);
+        level_nodes = std::move(parent_nodes);
+    }
+    return btree_status_t::success;
+}
+
 #if 0
 template < typename K, typename V >
 int64_t Btree< K, V >::compute_single_put_needed_size(const V& current_val, const V& new_val) const {
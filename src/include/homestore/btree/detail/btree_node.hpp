@@ -15,7 +15,11 @@
  *********************************************************************************/
 
 #pragma once
+#include <array>
+#include <atomic>
+#include <cstring>
 #include <iostream>
+#include <optional>
 #include <queue>
 #include <iomgr/fiber_lib.hpp>
 
@@ -26,30 +30,42 @@
 #include <homestore/btree/btree_kv.hpp>
 // #include <iomgr/iomgr_flip.hpp>
 #include <isa-l/crc.h>
+#include <farmhash.h>
 
 namespace homestore {
 ENUM(locktype_t, uint8_t, NONE, READ, WRITE)
+using data_ranges_t = std::array< std::pair< uint32_t, uint32_t >, 2 >;
 
-#pragma pack(1)
+// Not packed, since lock and version are accessed atomically and need their natural alignment
 struct transient_hdr_t {
     mutable iomgr::FiberManagerLib::shared_mutex lock;
     sisl::atomic_counter< uint16_t > upgraders{0};
 
+    // Bumped on both acquiring and releasing the write lock, so an odd version means a writer is active on the node.
+    // Used by lock free readers to validate what they read from the node.
+    std::atomic< uint64_t > version{0};
+
     /* these variables are accessed without taking lock and are not expected to change after init */
     uint8_t is_leaf_node{0};
 
+    // Stores which own the node buffer set this to get the buffer back once the last reference of the node is dropped
+    void (*buf_releaser)(void* owner, uint8_t* buf){nullptr};
+    void* buf_owner{nullptr};
+
     bool is_leaf() const { return (is_leaf_node != 0); }
 };
-#pragma pack()
 
-static constexpr uint8_t BTREE_NODE_VERSION = 1;
+static constexpr uint8_t BTREE_NODE_VERSION = 2;
+// Version 1 nodes have a 16 bit crc16 of the whole data area in place of the checksum type, and no 32 bit checksum
+static constexpr uint8_t BTREE_NODE_VERSION_V1 = 1;
 static constexpr uint8_t BTREE_NODE_MAGIC = 0xab;
 
 #pragma pack(1)
 struct persistent_hdr_t {
     uint8_t magic{BTREE_NODE_MAGIC};
     uint8_t version{BTREE_NODE_VERSION};
-    uint16_t checksum{0};
+    uint8_t checksum_type{0}; // Algorithm the checksum is computed with, of type btree_checksum_type
+    uint8_t reserved0{0};
 
     bnodeid_t node_id{empty_bnodeid};
     bnodeid_t next_node{empty_bnodeid};
@@ -65,14 +81,15 @@ struct persistent_hdr_t {
 
     uint16_t level; // Level of the node within the tree
     uint16_t reserved1;
-    uint32_t reserved2;
+    uint32_t checksum{0}; // Checksum of the used portion of the node data area
 
     persistent_hdr_t() : nentries{0}, leaf{0}, valid_node{1} {}
     std::string to_string() const {
-        return fmt::format("magic={} version={} csum={} node_id={} next_node={} nentries={} node_type={} is_leaf={} "
-                           "valid_node={} node_gen={} link_version={} edge_nodeid={}, edge_link_version={} level={} ",
-                           magic, version, checksum, node_id, next_node, nentries, node_type, leaf, valid_node,
-                           node_gen, link_version, edge_info.m_bnodeid, edge_info.m_link_version, level);
+        return fmt::format("magic={} version={} csum_type={} csum={} node_id={} next_node={} nentries={} node_type={} "
+                           "is_leaf={} valid_node={} node_gen={} link_version={} edge_nodeid={}, edge_link_version={} "
+                           "level={} ",
+                           magic, version, checksum_type, checksum, node_id, next_node, nentries, node_type, leaf,
+                           valid_node, node_gen, link_version, edge_info.m_bnodeid, edge_info.m_link_version, level);
     }
 };
 #pragma pack()
@@ -95,7 +112,7 @@ public:
         } else {
             DEBUG_ASSERT_EQ(node_id(), id);
             DEBUG_ASSERT_EQ(magic(), BTREE_NODE_MAGIC);
-            DEBUG_ASSERT_EQ(version(), BTREE_NODE_VERSION);
+            DEBUG_ASSERT_LE(version(), BTREE_NODE_VERSION);
         }
         m_trans_hdr.is_leaf_node = is_leaf;
     }
@@ -126,7 +143,7 @@ public:
         LOGMSG_ASSERT_EQ(magic(), BTREE_NODE_MAGIC, "Magic mismatch on btree_node {}",
                          get_persistent_header_const()->to_string());
         auto count = 0U;
-        bool sfound, efound;
+        bool sfound, efound, end_present;
         // Get the start index of the search range.
         std::tie(sfound, start_idx) = bsearch_node(range.start_key());
         if (sfound && !range.is_start_inclusive()) {
@@ -143,6 +160,7 @@ public:
         }
 
         std::tie(efound, end_idx) = bsearch_node(range.end_key());
+        end_present = efound;
         if (efound && !range.is_end_inclusive()) {
             if (end_idx == 0) { return 0; }
             --end_idx;
@@ -152,6 +170,10 @@ public:
         // If we point to same start and end without any match, it is hitting unavailable range
         if ((start_idx == end_idx) && is_leaf() && !sfound && !efound) { return 0; }
 
+        // Leaf entry at the end index is past the end key, if the end key is not present in the node. If it is
+        // present but exclusive, end index is already moved to the entry before it above.
+        if (is_leaf() && !end_present && (end_idx < total_entries())) { --end_idx; }
+
         if (end_idx == total_entries()) {
             DEBUG_ASSERT_GT(end_idx, 0); // At this point end_idx should never have been zero
             if (!has_valid_edge()) { --end_idx; }
@@ -421,6 +443,8 @@ public:
             m_trans_hdr.lock.lock_shared();
         } else if (l == locktype_t::WRITE) {
             m_trans_hdr.lock.lock();
+            m_trans_hdr.version.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
         }
     }
 
@@ -428,10 +452,25 @@ public:
         if (l == locktype_t::READ) {
             m_trans_hdr.lock.unlock_shared();
         } else if (l == locktype_t::WRITE) {
+            m_trans_hdr.version.fetch_add(1, std::memory_order_release);
             m_trans_hdr.lock.unlock();
         }
     }
 
+    // Lock free readers sample the version before reading the node and validate it afterwards. Returns false if a
+    // writer is currently active on the node.
+    bool optimistic_read_begin(uint64_t& version) const {
+        version = m_trans_hdr.version.load(std::memory_order_acquire);
+        return ((version & 1) == 0);
+    }
+
+    // Returns true if the node is not modified since the version was sampled, in which case whatever was read from the
+    // node in between is consistent.
+    bool optimistic_read_validate(uint64_t version) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return (m_trans_hdr.version.load(std::memory_order_relaxed) == version);
+    }
+
     void lock_upgrade() {
         m_trans_hdr.upgraders.increment(1);
         this->unlock(locktype_t::READ);
@@ -478,6 +517,10 @@ public:
     virtual void get_nth_value(uint32_t ind, BtreeValue* out_val, bool copy) const = 0;
     virtual void get_nth_key_internal(uint32_t ind, BtreeKey& out_key, bool copykey) const = 0;
 
+    // Serialized key and value of the nth entry, as views into the node which are valid only as long as the node is
+    // locked. Node which does not keep the key bytes contiguous assembles the key in the arena.
+    virtual std::pair< sisl::blob, sisl::blob > get_nth_kv_blobs(uint32_t ind, std::vector< uint8_t >& arena) const = 0;
+
     virtual btree_status_t insert(uint32_t ind, const BtreeKey& key, const BtreeValue& val) = 0;
     virtual void remove(uint32_t ind) { remove(ind, ind); }
     virtual void remove(uint32_t ind_s, uint32_t ind_e) = 0;
@@ -491,14 +534,20 @@ public:
     virtual int compare_nth_key(const BtreeKey& cmp_key, uint32_t ind) const = 0;
     virtual uint8_t* get_node_context() = 0;
 
+    // Lookup of the child link covering the key on an interior node without holding the node lock. Entries could be
+    // moved concurrently, so the result is usable only after validating the node version. Returns false if the child
+    // could not be located this way, including node layouts which cannot be safely read while being modified.
+    virtual bool find_child_optimistic(const BtreeKey& key, BtreeLinkInfo& child_info) const { return false; }
+
     // Method just to please compiler
     template < typename V >
     V edge_value_internal() const {
         return V{edge_id()};
     }
 
-private:
-    node_find_result_t bsearch_node(const BtreeKey& key) const {
+protected:
+    // Node layouts which can search their keys without per entry compare_nth_key() override this
+    virtual node_find_result_t bsearch_node(const BtreeKey& key) const {
         DEBUG_ASSERT_EQ(magic(), BTREE_NODE_MAGIC);
         auto [found, idx] = bsearch(-1, total_entries(), key);
         if (found) { DEBUG_ASSERT_LT(idx, total_entries()); }
@@ -542,22 +591,85 @@ public:
     void set_magic() { get_persistent_header()->magic = BTREE_NODE_MAGIC; }
 
     uint8_t version() const { return get_persistent_header_const()->version; }
-    uint16_t checksum() const { return get_persistent_header_const()->checksum; }
+    uint32_t checksum() const { return get_persistent_header_const()->checksum; }
     void init_checksum() { get_persistent_header()->checksum = 0; }
+    btree_checksum_type checksum_type() const {
+        return s_cast< btree_checksum_type >(get_persistent_header_const()->checksum_type);
+    }
+    // Node read in an older format is written back in the current one, since the checksum type replaces the old crc
+    void set_checksum_type(btree_checksum_type type) {
+        auto hdr = get_persistent_header();
+        hdr->version = BTREE_NODE_VERSION;
+        hdr->checksum_type = s_cast< uint8_t >(type);
+        hdr->reserved0 = 0;
+    }
 
     void set_node_id(bnodeid_t id) { get_persistent_header()->node_id = id; }
     bnodeid_t node_id() const { return get_persistent_header_const()->node_id; }
 
 #ifndef NO_CHECKSUM
-    void set_checksum(const BtreeConfig& cfg) {
-        get_persistent_header()->checksum = crc16_t10dif(bt_init_crc_16, node_data_area_const(), cfg.node_data_size());
+    void set_checksum(const BtreeConfig& cfg) { set_checksum(m_phys_node_buf, used_data_ranges(cfg)); }
+
+    // Computes the checksum of the raw node buffer with the algorithm recorded in its header, so that it can be done
+    // while flushing the buffer without the node.
+    static void set_checksum(uint8_t* node_buf, const data_ranges_t& ranges) {
+        auto hdr = r_cast< persistent_hdr_t* >(node_buf);
+        auto const csum = compute_checksum(s_cast< btree_checksum_type >(hdr->checksum_type),
+                                           node_buf + sizeof(persistent_hdr_t), ranges);
+        RELEASE_ASSERT(csum.has_value(), "Unknown checksum type on node {}", hdr->to_string());
+        hdr->checksum = *csum;
     }
 
     bool verify_node(const BtreeConfig& cfg) const {
         DEBUG_ASSERT_EQ(is_valid_node(), true, "verifying invalide node {}!",
                         get_persistent_header_const()->to_string());
-        auto exp_checksum = crc16_t10dif(bt_init_crc_16, node_data_area_const(), cfg.node_data_size());
-        return ((magic() == BTREE_NODE_MAGIC) && (checksum() == exp_checksum));
+        if (magic() != BTREE_NODE_MAGIC) { return false; }
+
+        if (version() == BTREE_NODE_VERSION_V1) {
+            uint16_t v1_checksum;
+            std::memcpy(&v1_checksum, &get_persistent_header_const()->checksum_type, sizeof(v1_checksum));
+            return (v1_checksum == crc16_t10dif(bt_init_crc_16, node_data_area_const(), cfg.node_data_size()));
+        } else if (version() != BTREE_NODE_VERSION) {
+            return false;
+        }
+
+        auto const exp_checksum = compute_checksum(checksum_type(), node_data_area_const(), used_data_ranges(cfg));
+        return (exp_checksum.has_value() && (checksum() == *exp_checksum));
+    }
+
+    // Returns nullopt for a checksum type which is not known, so that a corrupted type is not taken as a match
+    static std::optional< uint32_t > compute_checksum(btree_checksum_type type, const uint8_t* data_area,
+                                                      const data_ranges_t& ranges) {
+        uint32_t csum{0};
+        switch (type) {
+        case btree_checksum_type::CRC16_T10DIF:
+            csum = bt_init_crc_16;
+            for (const auto& [offset, size] : ranges) {
+                csum = crc16_t10dif(s_cast< uint16_t >(csum), data_area + offset, size);
+            }
+            break;
+
+        case btree_checksum_type::CRC32C:
+            csum = bt_init_crc_32;
+            for (const auto& [offset, size] : ranges) {
+                csum = crc32_iscsi(const_cast< uint8_t* >(data_area + offset), s_cast< int >(size), csum);
+            }
+            break;
+
+        case btree_checksum_type::FARMHASH:
+            csum = bt_init_crc_32;
+            for (const auto& [offset, size] : ranges) {
+                csum = util::Hash32WithSeed(r_cast< const char* >(data_area + offset), size, csum);
+            }
+            break;
+
+        case btree_checksum_type::NONE:
+            break;
+
+        default:
+            return std::nullopt;
+        }
+        return csum;
     }
 #endif
 
@@ -590,6 +702,12 @@ public:
     virtual uint32_t occupied_size(const BtreeConfig& cfg) const {
         return (cfg.node_data_size() - available_size(cfg));
     }
+
+    // Parts of the node data area which are in use, as (offset, size) pairs. Rest of the data area is free space whose
+    // contents do not matter and is skipped by the checksum.
+    virtual data_ranges_t used_data_ranges(const BtreeConfig& cfg) const {
+        return data_ranges_t{{{0u, cfg.node_data_size()}, {0u, 0u}}};
+    }
     bool is_merge_needed(const BtreeConfig& cfg) const {
 #if 0
 #ifdef _PRERELEASE
@@ -626,8 +744,12 @@ public:
 
     friend void intrusive_ptr_release(BtreeNode* node) {
         if (node->m_refcount.decrement_testz(1)) {
+            auto const releaser = node->m_trans_hdr.buf_releaser;
+            auto const owner = node->m_trans_hdr.buf_owner;
+            auto const buf = node->m_phys_node_buf;
             node->~BtreeNode();
             delete[] uintptr_cast(node);
+            if (releaser) { (*releaser)(owner, buf); }
         }
     }
 };
@@ -641,4 +763,32 @@ struct btree_locked_node_info {
     void dump() const { LOGINFO("node locked by file: {}, line: {}", fname, line); }
 };
 
+// Time spent by a profiled operation in each of its phases. Phases can nest, e.g. node writes done as part of split
+// are accounted in both.
+struct btree_op_profile {
+    Clock::time_point start_time{Clock::now()};
+    std::array< uint64_t, num_btree_op_phases > phase_ns{};
+    uint32_t route_length{0}; // Nodes visited, either locked or traversed lock free
+
+    void add(btree_op_phase_t phase, uint64_t ns) { phase_ns[s_cast< uint32_t >(phase)] += ns; }
+    uint64_t phase_time(btree_op_phase_t phase) const { return phase_ns[s_cast< uint32_t >(phase)]; }
+    uint64_t elapsed_ns() const { return get_elapsed_time_ns(start_time); }
+};
+
+// Accounts the time spent in its scope to the phase of the operation, if the operation is being profiled
+class btree_op_phase_timer {
+public:
+    btree_op_phase_timer(btree_op_profile* profile, btree_op_phase_t phase) : m_profile{profile}, m_phase{phase} {
+        if (m_profile) { m_start_time = Clock::now(); }
+    }
+    ~btree_op_phase_timer() {
+        if (m_profile) { m_profile->add(m_phase, get_elapsed_time_ns(m_start_time)); }
+    }
+
+private:
+    btree_op_profile* m_profile;
+    btree_op_phase_t m_phase;
+    Clock::time_point m_start_time;
+};
+
 } // namespace homestore
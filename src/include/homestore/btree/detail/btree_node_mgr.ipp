@@ -18,6 +18,8 @@
 #include <homestore/btree/btree.hpp>
 #include <homestore/btree/detail/simple_node.hpp>
 #include <homestore/btree/detail/varlen_node.hpp>
+#include <homestore/btree/detail/prefix_node.hpp>
+#include <homestore/btree/detail/compact_node.hpp>
 #include <sisl/fds/utils.hpp>
 // #include <iomgr/iomgr_flip.hpp>
 
@@ -41,16 +43,135 @@ btree_status_t Btree< K, V >::create_root_node(void* op_context) {
     }
 
     m_root_node_info = BtreeLinkInfo{root->node_id(), root->link_version()};
+    publish_root_node(root);
     return ret;
 }
 
+/*
+ * It reads the current root node and take a lock of the node. Root is published as a rcu protected pointer, so that
+ * regular operations do not need any tree wide lock. Root could get split or collapsed before the lock is acquired,
+ * in which case it is not the root anymore and we retry with the new root. Since root is changed only while holding
+ * the write lock of the old root, a locked node which is still published as root, remains the root until unlocked.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::read_and_lock_root(BtreeNodePtr& root, locktype_t int_lock_type,
+                                                 locktype_t leaf_lock_type, void* context) const {
+    while (true) {
+        {
+            folly::rcu_reader guard;
+            root.reset(m_root_node.load(std::memory_order_acquire));
+        }
+
+        if (sisl_unlikely(root == nullptr)) {
+            auto ret = load_root_node();
+            if (ret != btree_status_t::success) { return ret; }
+            continue;
+        }
+
+        auto const acq_lock = (root->is_leaf()) ? leaf_lock_type : int_lock_type;
+        auto ret = lock_node(root, acq_lock, context);
+        if (ret != btree_status_t::success) {
+            BT_LOG(ERROR, "Node lock and refresh failed");
+            return ret;
+        }
+        if (root.get() == m_root_node.load(std::memory_order_acquire)) { return ret; }
+
+        unlock_node(root, acq_lock);
+        COUNTER_INCREMENT(m_metrics, btree_retry_count, 1);
+    }
+}
+
+template < typename K, typename V >
+btree_status_t Btree< K, V >::load_root_node() const {
+    auto ret = btree_status_t::success;
+
+    m_btree_lock.lock();
+    if (m_root_node.load(std::memory_order_acquire) == nullptr) {
+        BtreeNodePtr root;
+        ret = read_node_impl(m_root_node_info.bnode_id(), root);
+        if (root != nullptr) {
+            publish_root_node(root);
+        } else {
+            BT_LOG(ERROR, "Root node {} read failed, reason: {}", m_root_node_info.bnode_id(), ret);
+        }
+    }
+    m_btree_lock.unlock();
+    return ret;
+}
+
+// Root node keeps a reference for being published. Reference of the old root is released only after the rcu readers,
+// which could have loaded it, are done with it.
+template < typename K, typename V >
+void Btree< K, V >::publish_root_node(const BtreeNodePtr& root) const {
+    if (root != nullptr) { intrusive_ptr_add_ref(root.get()); }
+    auto old_root = m_root_node.exchange(root.get(), std::memory_order_acq_rel);
+    if (old_root != nullptr) { folly::rcu_retire(old_root, [](BtreeNode* n) { intrusive_ptr_release(n); }); }
+}
+
+/*
+ * Walks down to the leaf for the key with optimistic lock coupling: Version of each interior node is sampled before
+ * reading the child link out of it and validated after the child is resolved and its own version sampled. Interior
+ * nodes are visited as plain pointers within a single rcu reader section, since a freed node is reclaimed only after
+ * the grace period. Only the leaf and its parent, which are used past the rcu section, are referenced and returned
+ * along with the sampled parent version and the link to the parent. Caller is expected to validate the parent version
+ * once it has locked what it needs, before relying on either of them.
+ */
+template < typename K, typename V >
+bool Btree< K, V >::optimistic_descend(const BtreeKey& key, BtreeNodePtr& parent_node, uint64_t& parent_ver,
+                                       BtreeLinkInfo& parent_link, BtreeNodePtr& leaf_node) const {
+    folly::rcu_reader guard;
+    BtreeNode* my_node = m_root_node.load(std::memory_order_acquire);
+    if ((my_node == nullptr) || my_node->is_leaf()) { return false; }
+
+    // Root is changed only while its write lock is held, so if it is still the root after sampling an unlocked
+    // version, any subsequent change to it fails the validation.
+    uint64_t my_ver;
+    if (my_node->optimistic_read_begin(my_ver) && (my_node == m_root_node.load(std::memory_order_acquire))) {
+        BtreeLinkInfo my_link = my_node->link_info();
+        auto const profile = op_profile();
+        while (true) {
+            if (profile) { ++profile->route_length; }
+
+            // Child link has to be validated before it is resolved, so that a child which is unlinked and freed
+            // after the validation is not reclaimed underneath us.
+            BtreeLinkInfo child_info;
+            BtreeNode* child_node{nullptr};
+            if (!my_node->find_child_optimistic(key, child_info) || !my_node->optimistic_read_validate(my_ver) ||
+                (read_node_optimistic_impl(child_info.bnode_id(), child_node) != btree_status_t::success)) {
+                break;
+            }
+
+            if (child_node->is_leaf()) {
+                parent_node.reset(my_node);
+                leaf_node.reset(child_node);
+                parent_ver = my_ver;
+                parent_link = my_link;
+                return true;
+            }
+
+            uint64_t child_ver;
+            if (!child_node->optimistic_read_begin(child_ver) || !my_node->optimistic_read_validate(my_ver)) { break; }
+            my_node = child_node;
+            my_ver = child_ver;
+            my_link = child_info;
+        }
+    }
+
+    COUNTER_INCREMENT(m_metrics, btree_optimistic_read_fallbacks, 1);
+    return false;
+}
+
 /*
  * It reads the node and take a lock of the node.
  */
 template < typename K, typename V >
 btree_status_t Btree< K, V >::read_and_lock_node(bnodeid_t id, BtreeNodePtr& node_ptr, locktype_t int_lock_type,
                                                  locktype_t leaf_lock_type, void* context) const {
-    auto ret = read_node_impl(id, node_ptr);
+    btree_status_t ret;
+    {
+        btree_op_phase_timer timer{op_profile(), btree_op_phase_t::NODE_READ};
+        ret = read_node_impl(id, node_ptr);
+    }
     if (node_ptr == nullptr) {
         if (ret != btree_status_t::fast_path_not_possible) { BT_LOG(ERROR, "read failed, reason: {}", ret); }
         return ret;
@@ -84,6 +205,7 @@ btree_status_t Btree< K, V >::get_child_and_lock_node(const BtreeNodePtr& node,
 
 template < typename K, typename V >
 btree_status_t Btree< K, V >::write_node(const BtreeNodePtr& node, void* context) {
+    btree_op_phase_timer timer{op_profile(), btree_op_phase_t::NODE_WRITE};
     COUNTER_INCREMENT_IF_ELSE(m_metrics, node->is_leaf(), btree_leaf_node_writes, btree_int_node_writes, 1);
     HISTOGRAM_OBSERVE_IF_ELSE(m_metrics, node->is_leaf(), btree_leaf_node_occupancy, btree_int_node_occupancy,
                               ((m_node_size - node->available_size(m_bt_cfg)) * 100) / m_node_size);
@@ -210,7 +332,12 @@ template < typename K, typename V >
 btree_status_t Btree< K, V >::_lock_node(const BtreeNodePtr& node, locktype_t type, void* context, const char* fname,
                                          int line) const {
     _start_of_lock(node, type, fname, line);
-    node->lock(type);
+    auto const profile = op_profile();
+    if (profile) { ++profile->route_length; }
+    {
+        btree_op_phase_timer timer{profile, btree_op_phase_t::LOCK_WAIT};
+        node->lock(type);
+    }
 
     auto ret = refresh_node(node, (type == locktype_t::WRITE), context);
     if (ret != btree_status_t::success) {
@@ -287,6 +414,18 @@ BtreeNode* Btree< K, V >::init_node(uint8_t* node_buf, uint32_t node_ctx_size, b
                                                                         this->m_bt_cfg);
         break;
 
+    case btree_node_type::PREFIX:
+        n = is_leaf ? create_node< PrefixNode< K, V > >(node_ctx_size, node_buf, id, init_buf, true, this->m_bt_cfg)
+                    : create_node< PrefixNode< K, BtreeLinkInfo > >(node_ctx_size, node_buf, id, init_buf, false,
+                                                                    this->m_bt_cfg);
+        break;
+
+    case btree_node_type::COMPACT:
+        n = is_leaf ? create_node< CompactNode< K, V > >(node_ctx_size, node_buf, id, init_buf, true, this->m_bt_cfg)
+                    : create_node< CompactNode< K, BtreeLinkInfo > >(node_ctx_size, node_buf, id, init_buf, false,
+                                                                     this->m_bt_cfg);
+        break;
+
     default:
         BT_REL_ASSERT(false, "Unsupported node type {}", node_type);
         break;
@@ -324,6 +463,18 @@ void Btree< K, V >::observe_lock_time(const BtreeNodePtr& node, locktype_t type,
     }
 }
 
+template < typename K, typename V >
+void Btree< K, V >::observe_op_profile(const btree_op_profile& profile) const {
+    COUNTER_INCREMENT(m_metrics, btree_profiled_ops_count, 1);
+    HISTOGRAM_OBSERVE(m_metrics, btree_op_latency, profile.elapsed_ns());
+    HISTOGRAM_OBSERVE(m_metrics, btree_op_lock_wait_time, profile.phase_time(btree_op_phase_t::LOCK_WAIT));
+    HISTOGRAM_OBSERVE(m_metrics, btree_op_node_read_time, profile.phase_time(btree_op_phase_t::NODE_READ));
+    HISTOGRAM_OBSERVE(m_metrics, btree_op_node_write_time, profile.phase_time(btree_op_phase_t::NODE_WRITE));
+    HISTOGRAM_OBSERVE(m_metrics, btree_op_split_time, profile.phase_time(btree_op_phase_t::SPLIT));
+    HISTOGRAM_OBSERVE(m_metrics, btree_op_merge_time, profile.phase_time(btree_op_phase_t::MERGE));
+    HISTOGRAM_OBSERVE(m_metrics, btree_op_route_length, profile.route_length);
+}
+
 template < typename K, typename V >
 void Btree< K, V >::_start_of_lock(const BtreeNodePtr& node, locktype_t ltype, const char* fname, int line) {
     btree_locked_node_info info;
@@ -335,14 +486,15 @@ void Btree< K, V >::_start_of_lock(const BtreeNodePtr& node, locktype_t ltype, c
 
     info.start_time = Clock::now();
     info.node = node.get();
+    auto vars = bt_thread_vars();
     if (ltype == locktype_t::WRITE) {
-        bt_thread_vars()->wr_locked_nodes.push_back(info);
+        vars->wr_locked_nodes.push_back(info);
         LOGTRACEMOD(btree, "ADDING node {} to write locked nodes list, its size={}", (void*)info.node,
-                    bt_thread_vars()->wr_locked_nodes.size());
+                    vars->wr_locked_nodes.size());
     } else if (ltype == locktype_t::READ) {
-        bt_thread_vars()->rd_locked_nodes.push_back(info);
+        vars->rd_locked_nodes.push_back(info);
         LOGTRACEMOD(btree, "ADDING node {} to read locked nodes list, its size={}", (void*)info.node,
-                    bt_thread_vars()->rd_locked_nodes.size());
+                    vars->rd_locked_nodes.size());
     } else {
         DEBUG_ASSERT(false, "Invalid locktype_t {}", ltype);
     }
@@ -350,8 +502,8 @@ void Btree< K, V >::_start_of_lock(const BtreeNodePtr& node, locktype_t ltype, c
 
 template < typename K, typename V >
 bool Btree< K, V >::remove_locked_node(const BtreeNodePtr& node, locktype_t ltype, btree_locked_node_info* out_info) {
-    auto pnode_infos =
-        (ltype == locktype_t::WRITE) ? &bt_thread_vars()->wr_locked_nodes : &bt_thread_vars()->rd_locked_nodes;
+    auto vars = bt_thread_vars();
+    auto pnode_infos = (ltype == locktype_t::WRITE) ? &vars->wr_locked_nodes : &vars->rd_locked_nodes;
 
     if (!pnode_infos->empty()) {
         auto info = pnode_infos->back();
@@ -405,14 +557,15 @@ template < typename K, typename V >
 void Btree< K, V >::check_lock_debug() {
     // both wr_locked_nodes and rd_locked_nodes are thread_local;
     // nothing will be dumpped if there is no assert failure;
-    for (const auto& x : bt_thread_vars()->wr_locked_nodes) {
+    auto vars = bt_thread_vars();
+    for (const auto& x : vars->wr_locked_nodes) {
         x.dump();
     }
-    for (const auto& x : bt_thread_vars()->rd_locked_nodes) {
+    for (const auto& x : vars->rd_locked_nodes) {
         x.dump();
     }
-    DEBUG_ASSERT_EQ(bt_thread_vars()->wr_locked_nodes.size(), 0);
-    DEBUG_ASSERT_EQ(bt_thread_vars()->rd_locked_nodes.size(), 0);
+    DEBUG_ASSERT_EQ(vars->wr_locked_nodes.size(), 0);
+    DEBUG_ASSERT_EQ(vars->rd_locked_nodes.size(), 0);
 }
 #endif
 
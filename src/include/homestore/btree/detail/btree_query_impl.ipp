@@ -19,8 +19,9 @@
 namespace homestore {
 
 template < typename K, typename V >
+template < typename OutT >
 btree_status_t Btree< K, V >::do_sweep_query(BtreeNodePtr& my_node, BtreeQueryRequest< K >& qreq,
-                                             std::vector< std::pair< K, V > >& out_values) const {
+                                             OutT& out_values) const {
     btree_status_t ret = btree_status_t::success;
     if (my_node->is_leaf()) {
         BT_NODE_DBG_ASSERT_GT(qreq.batch_size(), 0, my_node);
@@ -32,16 +33,21 @@ btree_status_t Btree< K, V >::do_sweep_query(BtreeNodePtr& my_node, BtreeQueryRe
             if (next_node) {
                 unlock_node(my_node, locktype_t::READ);
                 my_node = next_node;
+
+                // Beyond the leaves read ahead from the parent, keep the read of the next sibling overlapped with
+                // consuming this one, unless the query range ends within this one
+                if ((m_bt_cfg.m_max_query_prefetch_nodes != 0) && (my_node->next_bnode() != empty_bnodeid) &&
+                    (my_node->total_entries() != 0) &&
+                    (my_node->get_last_key< K >().compare(qreq.input_range().end_key()) < 0)) {
+                    prefetch_node_impl(my_node->next_bnode());
+                }
             }
 
             uint32_t start_ind{0};
             uint32_t end_ind{0};
             auto cur_count =
                 my_node->template get_all< K, V >(qreq.next_range(), qreq.batch_size() - count, start_ind, end_ind);
-            for (auto idx{start_ind}; idx < (start_ind + cur_count); ++idx) {
-                call_on_read_kv_cb(my_node, idx, qreq);
-                my_node->add_nth_obj_to_list(idx, &out_values, true);
-            }
+            add_query_results(my_node, start_ind, cur_count, qreq, out_values);
             count += cur_count;
 
             if (qreq.route_tracing) {
@@ -66,7 +72,16 @@ btree_status_t Btree< K, V >::do_sweep_query(BtreeNodePtr& my_node, BtreeQueryRe
             }
         } while (true);
 
-        unlock_node(my_node, locktype_t::READ);
+        if ((ret == btree_status_t::has_more) &&
+            (qreq.query_type() == BtreeQueryType::SWEEP_INTRUSIVE_PAGINATION_QUERY)) {
+            // Leaf stays locked for the next page, with its lock owned by the query cursor
+            end_of_lock(my_node, locktype_t::READ);
+            auto tracker = std::make_unique< BtreeQueryLockTracker >();
+            tracker->push(my_node);
+            qreq.cursor()->m_locked_nodes = std::move(tracker);
+        } else {
+            unlock_node(my_node, locktype_t::READ);
+        }
         return ret;
     }
 
@@ -78,14 +93,69 @@ btree_status_t Btree< K, V >::do_sweep_query(BtreeNodePtr& my_node, BtreeQueryRe
     BtreeNodePtr child_node;
     ret = read_and_lock_node(start_child_info.bnode_id(), child_node, locktype_t::READ, locktype_t::READ,
                              qreq.m_op_context);
+    if ((ret == btree_status_t::success) && child_node->is_leaf()) {
+        prefetch_sweep_leaves(my_node, idx, child_node, qreq);
+    }
     unlock_node(my_node, locktype_t::READ);
     if (ret != btree_status_t::success) { return ret; }
     return (do_sweep_query(child_node, qreq, out_values));
 }
 
+/*
+ * Readahead for sweep query: Leaves which the sweep walks after the first one are its next siblings under the same
+ * parent, so their ids are picked up from the parent while it is still locked and handed to the store to read in the
+ * background, while the current leaf is consumed. Number of leaves read ahead is what the batch needs at the fill of
+ * the first leaf, bounded by the config and by the end of the query range.
+ */
+template < typename K, typename V >
+void Btree< K, V >::prefetch_sweep_leaves(const BtreeNodePtr& parent_node, uint32_t child_idx,
+                                          const BtreeNodePtr& leaf_node, const BtreeQueryRequest< K >& qreq) const {
+    if (m_bt_cfg.m_max_query_prefetch_nodes == 0) { return; }
+
+    auto nleaves = std::min(qreq.batch_size() / std::max(leaf_node->total_entries(), 1u),
+                            m_bt_cfg.m_max_query_prefetch_nodes);
+    for (auto idx{child_idx + 1}; (nleaves > 0) && (idx <= parent_node->total_entries()); ++idx, --nleaves) {
+        // Child holds the keys past the previous separator, so if that is beyond the range, so is the child
+        if (parent_node->compare_nth_key(qreq.input_range().end_key(), idx - 1) >= 0) { break; }
+
+        BtreeLinkInfo child_info;
+        if (idx == parent_node->total_entries()) {
+            if (!parent_node->has_valid_edge()) { break; }
+            child_info = parent_node->get_edge_value();
+        } else {
+            parent_node->get_nth_value(idx, &child_info, false);
+        }
+        prefetch_node_impl(child_info.bnode_id());
+    }
+}
+
+template < typename K, typename V >
+template < typename OutT >
+void Btree< K, V >::add_query_results(const BtreeNodePtr& node, uint32_t start_idx, uint32_t count,
+                                      BtreeQueryRequest< K >& qreq, OutT& out_values, bool reverse) const {
+    for (auto i{0u}; i < count; ++i) {
+        const auto idx = reverse ? (start_idx + count - 1 - i) : (start_idx + i);
+        call_on_read_kv_cb(node, idx, qreq);
+        if constexpr (std::is_same_v< OutT, QueryVisitSink >) {
+            const auto kv_blobs = node->get_nth_kv_blobs(idx, out_values.arena);
+            out_values.visitor(kv_blobs.first, kv_blobs.second);
+        } else {
+            node->add_nth_obj_to_list(idx, &out_values, true);
+        }
+    }
+
+    if constexpr (std::is_same_v< OutT, QueryVisitSink >) {
+        if (count) {
+            out_values.count += count;
+            out_values.last_key = node->template get_nth_key< K >(reverse ? start_idx : (start_idx + count - 1), true);
+        }
+    }
+}
+
 template < typename K, typename V >
+template < typename OutT >
 btree_status_t Btree< K, V >::do_traversal_query(const BtreeNodePtr& my_node, BtreeQueryRequest< K >& qreq,
-                                                 std::vector< std::pair< K, V > >& out_values) const {
+                                                 OutT& out_values) const {
     btree_status_t ret = btree_status_t::success;
     uint32_t idx;
 
@@ -93,15 +163,9 @@ btree_status_t Btree< K, V >::do_traversal_query(const BtreeNodePtr& my_node, Bt
         BT_NODE_LOG_ASSERT_GT(qreq.batch_size(), 0, my_node);
 
         uint32_t start_ind = 0, end_ind = 0;
-        auto cur_count = my_node->get_all(qreq.next_range(), qreq.batch_size() - (uint32_t)out_values.size(), start_ind,
-                                          end_ind, &out_values);
-
-        if (cur_count) {
-            for (auto idx{start_ind}; idx < (start_ind + cur_count); ++idx) {
-                call_on_read_kv_cb(my_node, idx, qreq);
-                // my_node->add_nth_obj_to_list(idx, &out_values, true);
-            }
-        }
+        auto cur_count = my_node->template get_all< K, V >(
+            qreq.next_range(), qreq.batch_size() - (uint32_t)out_values.size(), start_ind, end_ind);
+        add_query_results(my_node, start_ind, cur_count, qreq, out_values);
 
         if (qreq.route_tracing) {
             append_route_trace(qreq, my_node, btree_event_t::READ, start_ind, start_ind + cur_count);
@@ -153,188 +217,193 @@ done:
     return ret;
 }
 
-#ifdef SERIALIZABLE_QUERY_IMPLEMENTATION
-btree_status_t do_serialzable_query(const BtreeNodePtr& my_node, BtreeSerializableQueryRequest& qreq,
-                                    std::vector< std::pair< K, V > >& out_values) {
-
+/*
+ * Reverse sweep query: Leaves are not linked to their previous sibling, so the leaves are walked right to left from
+ * their parents. Each interior node visits the children from the one holding the next key (the cursor on pagination,
+ * or else the end of range) down to the one holding the start of range, keeping the node locked until it descends to
+ * the last of them, same as traversal query. Leaf hands out its last entries in the range, in descending order.
+ */
+template < typename K, typename V >
+template < typename OutT >
+btree_status_t Btree< K, V >::do_reverse_sweep_query(const BtreeNodePtr& my_node, BtreeQueryRequest< K >& qreq,
+                                                     OutT& out_values) const {
     btree_status_t ret = btree_status_t::success;
-    if (my_node->is_leaf) {
-        auto count = 0;
-        auto start_result = my_node->find(qreq.get_start_of_range(), nullptr, nullptr);
-        auto start_ind = start_result.end_of_search_index;
-
-        auto end_result = my_node->find(qreq.get_end_of_range(), nullptr, nullptr);
-        auto end_ind = end_result.end_of_search_index;
-        if (!end_result.found) { end_ind--; } // not found entries will point to 1 ind after last in range.
-
-        ind = start_ind;
-        while ((ind <= end_ind) && (count < qreq.batch_size())) {
-            K key;
-            V value;
-            my_node->get_nth_element(ind, &key, &value, false);
-
-            if (!qreq.m_match_item_cb || qreq.m_match_item_cb(key, value)) {
-                out_values.emplace_back(std::make_pair< K, V >(key, value));
-                count++;
-            }
-            ind++;
-        }
-
-        bool has_more = ((ind >= start_ind) && (ind < end_ind));
-        if (!has_more) {
-            unlock_node(my_node, locktype_t::READ);
-            get_tracker(qreq)->pop();
-            return success;
-        }
 
-        return has_more;
-    }
+    if (my_node->is_leaf()) {
+        BT_NODE_LOG_ASSERT_GT(qreq.batch_size(), 0, my_node);
 
-    BtreeNodeId start_child_ptr, end_child_ptr;
-    auto start_ret = my_node->find(qreq.get_start_of_range(), nullptr, &start_child_ptr);
-    ASSERT_IS_VALID_INTERIOR_CHILD_INDX(start_ret, my_node);
-    auto end_ret = my_node->find(qreq.get_end_of_range(), nullptr, &end_child_ptr);
-    ASSERT_IS_VALID_INTERIOR_CHILD_INDX(end_ret, my_node);
+        uint32_t start_ind{0};
+        uint32_t end_ind{0};
+        auto cur_count = my_node->template get_all< K, V >(qreq.reverse_next_range(), UINT32_MAX, start_ind, end_ind);
 
-    BtreeNodePtr child_node;
-    if (start_ret.end_of_search_index == end_ret.end_of_search_index) {
-        BT_LOG_ASSERT_CMP(start_child_ptr, ==, end_child_ptr, my_node);
+        // Take only as many entries from the end of what is found, as the batch has room for
+        const auto room = qreq.batch_size() - (uint32_t)out_values.size();
+        if (cur_count > room) {
+            start_ind += (cur_count - room);
+            cur_count = room;
+        }
+        add_query_results(my_node, start_ind, cur_count, qreq, out_values, true /* reverse */);
 
-        ret = read_and_lock_node(start_child_ptr.node_id(), child_node, locktype_t::READ, locktype_t::READ, nullptr);
-        if (ret != btree_status_t::success) {
-            unlock_node(my_node, locktype_t::READ);
-            return ret;
+        if (qreq.route_tracing) {
+            append_route_trace(qreq, my_node, btree_event_t::READ, start_ind, start_ind + cur_count);
         }
         unlock_node(my_node, locktype_t::READ);
+        if (out_values.size() >= qreq.batch_size()) { ret = btree_status_t::has_more; }
+        return ret;
+    }
 
-        // Pop the last node and push this child node
-        get_tracker(qreq)->pop();
-        get_tracker(qreq)->push(child_node);
-        return do_serialzable_query(child_node, qreq, search_range, out_values);
-    } else {
-        // This is where the deviation of tree happens. Do not pop the node out of lock tracker
-        bool has_more = false;
-
-        for (auto i = start_ret.end_of_search_index; i <= end_ret.end_of_search_index; i++) {
-            BtreeNodeId child_ptr;
-            my_node->get_nth_value(i, &child_ptr, false);
-            ret = read_and_lock_node(child_ptr.node_id(), child_node, locktype_t::READ, locktype_t::READ, nullptr);
-            if (ret != btree_status_t::success) {
-                unlock_node(my_node, locktype_t::READ);
-                return ret;
-            }
-
-            get_tracker(qreq)->push(child_node);
-
-            ret = do_serialzable_query(child_node, qreq, out_values);
-            if (ret == BTREE_AGAIN) {
-                BT_LOG_ASSERT_CMP(out_values.size(), ==, qreq.batch_size(), );
-                break;
-            }
+    [[maybe_unused]] const auto [start_isfound, start_idx] =
+        my_node->find(qreq.input_range().start_key(), nullptr, false);
+    [[maybe_unused]] auto [end_isfound, end_idx] = my_node->find(qreq.reverse_next_key(), nullptr, false);
+    if (!my_node->has_valid_edge()) {
+        if (start_idx == my_node->total_entries()) {
+            unlock_node(my_node, locktype_t::READ);
+            return ret; // no results found
         }
+        if (end_idx == my_node->total_entries()) { --end_idx; }
+    }
+    BT_NODE_LOG_ASSERT_LE(start_idx, end_idx, my_node);
+    if (qreq.route_tracing) { append_route_trace(qreq, my_node, btree_event_t::READ, start_idx, end_idx); }
+
+    bool unlocked_already{false};
+    for (auto idx{end_idx + 1}; idx-- > start_idx;) {
+        BtreeLinkInfo child_info;
+        my_node->get_nth_value(idx, &child_info, false);
+        BtreeNodePtr child_node = nullptr;
+        ret = read_and_lock_node(child_info.bnode_id(), child_node, locktype_t::READ, locktype_t::READ,
+                                 qreq.m_op_context);
+        if (ret != btree_status_t::success) { break; }
 
-        if (ret == BTREE_SUCCESS) {
+        if (idx == start_idx) {
+            // Leftmost child of the range is the last one to visit, so no need to hold this node any longer
             unlock_node(my_node, locktype_t::READ);
-            HS_DEBUG_ASSERT_EQ(get_tracker(qreq)->top(), my_node);
-            get_tracker(qreq)->pop();
+            unlocked_already = true;
         }
-        return ret;
+        ret = do_reverse_sweep_query(child_node, qreq, out_values);
+        if (ret != btree_status_t::success) { break; }
     }
-}
-#endif
+    if (!unlocked_already) { unlock_node(my_node, locktype_t::READ); }
 
-#ifdef SERIALIZABLE_QUERY_IMPLEMENTATION
-btree_status_t sweep_query(BtreeQueryRequest< K >& qreq, std::vector< std::pair< K, V > >& out_values) {
-    COUNTER_INCREMENT(m_metrics, btree_read_ops_count, 1);
-    qreq.init_batch_range();
+    return ret;
+}
 
-    m_btree_lock.lock_shared();
+/*
+ * Intrusive sweep query: Same walk as the sweep query, except that the leaf where a page ends is kept read locked and
+ * its lock handed over to the query cursor. Next page continues from that leaf, instead of walking down from the root
+ * again. Writers to that leaf wait till the query completes or its cursor is destroyed.
+ */
+template < typename K, typename V >
+template < typename OutT >
+btree_status_t Btree< K, V >::do_intrusive_sweep_query(BtreeNodePtr& my_node, BtreeQueryRequest< K >& qreq,
+                                                       OutT& out_values) const {
+    auto tracker = query_lock_tracker(qreq);
+    if (tracker != nullptr) {
+        // Take the lock of the leaf previous page ended at back from the cursor
+        my_node = tracker->m_nodes.back();
+        tracker->m_nodes.pop_back();
+        release_query_locks(qreq);
+        _start_of_lock(my_node, locktype_t::READ, __FILE__, __LINE__);
+    }
+    return do_sweep_query(my_node, qreq, out_values);
+}
 
-    BtreeNodePtr root;
+/*
+ * Serializable query: First page read locks all the leaves covering the query range and hands over their locks to the
+ * query cursor, which keeps them till the query completes. No entry in the range can be inserted, updated or removed
+ * in the meantime, so the pages put together are a consistent snapshot of the range. Pages are served from the locked
+ * leaves, without walking down the tree again. Since writers to any of these leaves wait for the whole query, the
+ * query fails with not_supported, without returning anything, if its range spans more than m_max_query_locked_nodes.
+ */
+template < typename K, typename V >
+template < typename OutT >
+btree_status_t Btree< K, V >::do_serializable_query(BtreeNodePtr& my_node, BtreeQueryRequest< K >& qreq,
+                                                    OutT& out_values) const {
     btree_status_t ret = btree_status_t::success;
+    if (query_lock_tracker(qreq) == nullptr) {
+        ret = lock_query_range(my_node, qreq);
+        if (ret != btree_status_t::success) { return ret; }
+    }
 
-    ret = read_and_lock_node(m_root_node_info.bnode_id(), root, locktype_t::READ, locktype_t::READ, nullptr);
-    if (ret != btree_status_t::success) { goto out; }
+    auto tracker = query_lock_tracker(qreq);
+    auto count = 0U;
+    for (; tracker->m_cur < tracker->m_nodes.size(); ++tracker->m_cur) {
+        const auto& node = tracker->m_nodes[tracker->m_cur];
 
-    ret = do_sweep_query(root, qreq, out_values);
-out:
-    m_btree_lock.unlock_shared();
+        uint32_t start_ind{0};
+        uint32_t end_ind{0};
+        auto cur_count =
+            node->template get_all< K, V >(qreq.next_range(), qreq.batch_size() - count, start_ind, end_ind);
+        add_query_results(node, start_ind, cur_count, qreq, out_values);
+        count += cur_count;
 
-#ifndef NDEBUG
-    check_lock_debug();
-#endif
+        if (qreq.route_tracing) {
+            append_route_trace(qreq, node, btree_event_t::READ, start_ind, start_ind + cur_count);
+        }
+        if (count >= qreq.batch_size()) {
+            ret = btree_status_t::has_more;
+            break;
+        }
+    }
     return ret;
 }
 
-btree_status_t serializable_query(BtreeSerializableQueryRequest& qreq, std::vector< std::pair< K, V > >& out_values) {
-    qreq.init_batch_range();
-
-    m_btree_lock.lock_shared();
-    BtreeNodePtr node;
-    btree_status_t ret;
+template < typename K, typename V >
+btree_status_t Btree< K, V >::lock_query_range(BtreeNodePtr& my_node, BtreeQueryRequest< K >& qreq) const {
+    btree_status_t ret = btree_status_t::success;
 
-    if (qreq.is_empty_cursor()) {
-        // Initialize a new lock tracker and put inside the cursor.
-        qreq.cursor().m_locked_nodes = std::make_unique< BtreeLockTrackerImpl >(this);
+    // Walk down to the leaf which has the start of the range
+    while (!my_node->is_leaf()) {
+        BtreeLinkInfo child_info;
+        [[maybe_unused]] const auto [isfound, idx] = my_node->find(qreq.next_key(), &child_info, false);
+        ASSERT_IS_VALID_INTERIOR_CHILD_INDX(isfound, idx, my_node);
+        if (qreq.route_tracing) { append_route_trace(qreq, my_node, btree_event_t::READ, idx, idx); }
 
-        BtreeNodePtr root;
-        ret = read_and_lock_node(m_root_node_info.bnode_id(), root, locktype_t::READ, locktype_t::READ, nullptr);
-        if (ret != btree_status_t::success) { goto out; }
-        get_tracker(qreq)->push(root); // Start tracking the locked nodes.
-    } else {
-        node = get_tracker(qreq)->top();
+        BtreeNodePtr child_node;
+        ret = read_and_lock_node(child_info.bnode_id(), child_node, locktype_t::READ, locktype_t::READ,
+                                 qreq.m_op_context);
+        unlock_node(my_node, locktype_t::READ);
+        if (ret != btree_status_t::success) { return ret; }
+        my_node = child_node;
     }
 
-    ret = do_serialzable_query(node, qreq, out_values);
-out:
-    m_btree_lock.unlock_shared();
+    // Lock the leaves left to right till the end of the range. Any failure in between unlocks them as tracker goes away
+    auto tracker = std::make_unique< BtreeQueryLockTracker >();
+    do {
+        end_of_lock(my_node, locktype_t::READ);
+        tracker->push(my_node);
 
-    // TODO: Assert if key returned from do_get is same as key requested, incase of perfect match
+        if ((my_node->total_entries() != 0) &&
+            (my_node->get_last_key< K >().compare(qreq.input_range().end_key()) >= 0)) {
+            break;
+        }
+        if (my_node->next_bnode() == empty_bnodeid) { break; }
+
+        // Writers to all the locked leaves are held up till the query completes, so the range it can lock is bounded
+        if ((m_bt_cfg.m_max_query_locked_nodes != 0) &&
+            (tracker->m_nodes.size() >= m_bt_cfg.m_max_query_locked_nodes)) {
+            BT_LOG(ERROR, "Serializable query range spans more than {} leaves, which is the max it can lock",
+                   m_bt_cfg.m_max_query_locked_nodes);
+            return btree_status_t::not_supported;
+        }
 
-#ifndef NDEBUG
-    check_lock_debug();
-#endif
+        BtreeNodePtr next_node;
+        ret = read_and_lock_node(my_node->next_bnode(), next_node, locktype_t::READ, locktype_t::READ,
+                                 qreq.m_op_context);
+        if (ret != btree_status_t::success) { return ret; }
+        my_node = next_node;
+    } while (true);
 
+    qreq.cursor()->m_locked_nodes = std::move(tracker);
     return ret;
 }
 
-BtreeLockTrackerImpl* get_tracker(BtreeSerializableQueryRequest& qreq) {
-    return (BtreeLockTrackerImpl*)qreq->get_cursor.m_locked_nodes.get();
+template < typename K, typename V >
+BtreeQueryLockTracker* Btree< K, V >::query_lock_tracker(BtreeQueryRequest< K >& qreq) {
+    return static_cast< BtreeQueryLockTracker* >(qreq.cursor()->m_locked_nodes.get());
 }
 
 template < typename K, typename V >
-class BtreeLockTrackerImpl : public BtreeLockTracker {
-public:
-    BtreeLockTrackerImpl(btree_t* bt) : m_bt(bt) {}
-
-    virtual ~BtreeLockTrackerImpl() {
-        while (m_nodes.size()) {
-            auto& p = m_nodes.top();
-            m_bt->unlock_node(p.first, p.second);
-            m_nodes.pop();
-        }
-    }
-
-    void push(const BtreeNodePtr& node, locktype_t locktype) { m_nodes.emplace(std::make_pair<>(node, locktype)); }
-
-    std::pair< BtreeNodePtr, locktype_t > pop() {
-        HS_ASSERT_CMP(DEBUG, m_nodes.size(), !=, 0);
-        std::pair< BtreeNodePtr, locktype_t > p;
-        if (m_nodes.size()) {
-            p = m_nodes.top();
-            m_nodes.pop();
-        } else {
-            p = std::make_pair<>(nullptr, locktype_t::LOCKTYPE_NONE);
-        }
-
-        return p;
-    }
-
-    BtreeNodePtr top() { return (m_nodes.size == 0) ? nullptr : m_nodes.top().first; }
-
-private:
-    btree_t m_bt;
-    std::stack< std::pair< BtreeNodePtr, locktype_t > > m_nodes;
-};
-#endif
+void Btree< K, V >::release_query_locks(BtreeQueryRequest< K >& qreq) {
+    qreq.cursor()->m_locked_nodes.reset();
+}
 } // namespace homestore
@@ -125,8 +125,10 @@ retry:
 
                 if (is_repair_needed(child_node, child_info)) {
                     ret = repair_merge(my_node, child_node, curr_idx, req.m_op_context);
-                } else {
+                } else if (m_bt_cfg.m_merge_turned_on) {
                     ret = merge_nodes(my_node, child_node, curr_idx, node_end_idx, req.m_op_context);
+                } else {
+                    ret = btree_status_t::merge_not_required;
                 }
 
                 if ((ret != btree_status_t::success) && (ret != btree_status_t::merge_not_required)) {
@@ -293,8 +295,9 @@ btree_status_t Btree< K, V >::check_collapse_root(ReqT& req) {
     BtreeNodePtr root;
     btree_status_t ret = btree_status_t::success;
 
+    // Root changes are serialized with btree lock, so the root read here remains the root
     m_btree_lock.lock();
-    ret = read_and_lock_node(m_root_node_info.bnode_id(), root, locktype_t::WRITE, locktype_t::WRITE, req.m_op_context);
+    ret = read_and_lock_root(root, locktype_t::WRITE, locktype_t::WRITE, req.m_op_context);
     if (ret != btree_status_t::success) { goto done; }
 
     if (root->total_entries() != 0 || root->is_leaf()) {
@@ -312,8 +315,10 @@ btree_status_t Btree< K, V >::check_collapse_root(ReqT& req) {
 
     if (req.route_tracing) { append_route_trace(req, root, btree_event_t::MERGE); }
 
-    free_node(root, locktype_t::WRITE, req.m_op_context);
+    // New root has to be published before the old root is unlocked by free
     m_root_node_info = child->link_info();
+    publish_root_node(child);
+    free_node(root, locktype_t::WRITE, req.m_op_context);
     update_new_root_info(m_root_node_info.bnode_id(), m_root_node_info.link_version());
     unlock_node(child, locktype_t::WRITE);
 
@@ -328,7 +333,7 @@ done:
 template < typename K, typename V >
 btree_status_t Btree< K, V >::merge_nodes(const BtreeNodePtr& parent_node, const BtreeNodePtr& leftmost_node,
                                           uint32_t start_idx, uint32_t end_idx, void* context) {
-    if (!m_bt_cfg.m_merge_turned_on) { return btree_status_t::merge_not_required; }
+    btree_op_phase_timer timer{op_profile(), btree_op_phase_t::MERGE};
     btree_status_t ret{btree_status_t::success};
     folly::small_vector< BtreeNodePtr, 3 > old_nodes;
     folly::small_vector< BtreeNodePtr, 3 > new_nodes;
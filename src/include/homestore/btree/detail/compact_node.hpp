@@ -0,0 +1,397 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+#pragma once
+
+#include <homestore/btree/btree_kv.hpp>
+#include "btree_node.hpp"
+#include "btree_internal.hpp"
+#include "btree_key_search.hpp"
+#include "homestore/index/index_internal.hpp"
+
+SISL_LOGGING_DECL(btree)
+
+namespace homestore {
+#pragma pack(1)
+struct compact_node_header {
+    uint16_t m_capacity; // Number of entries the key and value arrays are sized for
+    uint16_t reserved[3];
+};
+#pragma pack()
+
+// Internal format of compact node:
+// [Persistent Header][compact node header][key][key][key]...   ...[value][value][value]...   ...
+//
+// Keys and values of fixed size are kept in two separate arrays, each sized for the node capacity. Search walks only
+// the key array, which is densely packed, and the value is read only for the entry it lands on. Apart from that it
+// behaves the same as SimpleNode.
+template < typename K, typename V >
+class CompactNode : public BtreeNode {
+public:
+    CompactNode(uint8_t* node_buf, bnodeid_t id, bool init, bool is_leaf, const BtreeConfig& cfg) :
+            BtreeNode(node_buf, id, init, is_leaf) {
+        this->set_node_type(btree_node_type::COMPACT);
+        if (init) {
+            get_compact_node_header()->m_capacity =
+                (cfg.node_data_size() - sizeof(compact_node_header)) / (get_key_size() + get_value_size());
+        }
+    }
+
+    // Insert the key and value in provided index
+    // Assumption: Node lock is already taken
+    btree_status_t insert(uint32_t ind, const BtreeKey& key, const BtreeValue& val) override {
+        uint32_t const nmove = this->total_entries() - ind;
+        if (nmove != 0) {
+            std::memmove(get_nth_key_ptr(ind + 1), get_nth_key_ptr(ind), nmove * get_key_size());
+            std::memmove(get_nth_value_ptr(ind + 1), get_nth_value_ptr(ind), nmove * get_value_size());
+        }
+        this->set_nth_obj(ind, key, val);
+        this->inc_entries();
+        this->inc_gen();
+
+#ifndef NDEBUG
+        validate_sanity();
+#endif
+        return btree_status_t::success;
+    }
+
+    void update(uint32_t ind, const BtreeValue& val) override {
+        set_nth_value(ind, val);
+        this->inc_gen();
+    }
+
+    void update(uint32_t ind, const BtreeKey& key, const BtreeValue& val) override {
+        if (ind == this->total_entries()) {
+            DEBUG_ASSERT_EQ(this->is_leaf(), false);
+            this->set_edge_value(val);
+        } else {
+            set_nth_obj(ind, key, val);
+        }
+        this->inc_gen();
+    }
+
+    // ind_s and ind_e are inclusive
+    void remove(uint32_t ind_s, uint32_t ind_e) override {
+        uint32_t const total_entries = this->total_entries();
+        DEBUG_ASSERT_GE(total_entries, ind_s, "node={}", to_string());
+        DEBUG_ASSERT_GE(total_entries, ind_e, "node={}", to_string());
+
+        if (ind_e == total_entries) { // edge entry
+            DEBUG_ASSERT((!this->is_leaf() && this->has_valid_edge()), "node={}", to_string());
+            // Set the last key/value as edge entry and by decrementing entry count automatically removed the last
+            // entry.
+            BtreeLinkInfo new_edge;
+            get_nth_value(ind_s - 1, &new_edge, false);
+            this->set_nth_value(total_entries, new_edge);
+            this->sub_entries(total_entries - ind_s + 1);
+        } else {
+            uint32_t const nmove = total_entries - ind_e - 1;
+            if (nmove != 0) {
+                std::memmove(get_nth_key_ptr(ind_s), get_nth_key_ptr(ind_e + 1), nmove * get_key_size());
+                std::memmove(get_nth_value_ptr(ind_s), get_nth_value_ptr(ind_e + 1), nmove * get_value_size());
+            }
+            this->sub_entries(ind_e - ind_s + 1);
+        }
+        this->inc_gen();
+#ifndef NDEBUG
+        validate_sanity();
+#endif
+    }
+
+    void remove_all(const BtreeConfig& cfg) override {
+        this->sub_entries(this->total_entries());
+        this->invalidate_edge();
+        this->inc_gen();
+    }
+
+    void append(uint32_t ind, const BtreeKey& key, const BtreeValue& val) override {
+        RELEASE_ASSERT(false, "Append operation is not supported on compact node");
+    }
+
+    uint32_t move_out_to_right_by_entries(const BtreeConfig& cfg, BtreeNode& o, uint32_t nentries) override {
+        auto& other_node = s_cast< CompactNode< K, V >& >(o);
+
+        // Minimum of whats to be moved out and how many slots available in other node
+        nentries = std::min({nentries, this->total_entries(), other_node.get_available_entries()});
+        if (nentries != 0) {
+            uint32_t const other_nentries = other_node.total_entries();
+            uint32_t const start = this->total_entries() - nentries;
+            std::memmove(other_node.get_nth_key_ptr(nentries), other_node.get_nth_key_ptr(0),
+                         other_nentries * get_key_size());
+            std::memmove(other_node.get_nth_value_ptr(nentries), other_node.get_nth_value_ptr(0),
+                         other_nentries * get_value_size());
+            std::memcpy(other_node.get_nth_key_ptr(0), get_nth_key_ptr(start), nentries * get_key_size());
+            std::memcpy(other_node.get_nth_value_ptr(0), get_nth_value_ptr(start), nentries * get_value_size());
+        }
+
+        other_node.add_entries(nentries);
+        this->sub_entries(nentries);
+
+        // If there is an edgeEntry in this node, it needs to move to move out as well.
+        if (!this->is_leaf() && this->has_valid_edge()) {
+            other_node.set_edge_info(this->edge_info());
+            this->invalidate_edge();
+        }
+
+        other_node.inc_gen();
+        this->inc_gen();
+
+#ifndef NDEBUG
+        validate_sanity();
+#endif
+        return nentries;
+    }
+
+    uint32_t move_out_to_right_by_size(const BtreeConfig& cfg, BtreeNode& o, uint32_t size) override {
+        return (get_nth_obj_size(0) * move_out_to_right_by_entries(cfg, o, size / get_nth_obj_size(0)));
+    }
+
+    uint32_t num_entries_by_size(uint32_t start_idx, uint32_t size) const override {
+        return std::min(size / get_nth_obj_size(0), this->total_entries() - start_idx);
+    }
+
+    uint32_t copy_by_size(const BtreeConfig& cfg, const BtreeNode& o, uint32_t start_idx, uint32_t size) override {
+        auto& other = s_cast< const CompactNode< K, V >& >(o);
+        return copy_by_entries(cfg, o, start_idx, other.num_entries_by_size(start_idx, size));
+    }
+
+    uint32_t copy_by_entries(const BtreeConfig& cfg, const BtreeNode& o, uint32_t start_idx,
+                             uint32_t nentries) override {
+        auto& other = s_cast< const CompactNode< K, V >& >(o);
+
+        nentries = std::min(nentries, other.total_entries() - start_idx);
+        nentries = std::min(nentries, this->get_available_entries());
+        if (nentries != 0) {
+            std::memcpy(get_nth_key_ptr(this->total_entries()), other.get_nth_key_ptr(start_idx),
+                        nentries * get_key_size());
+            std::memcpy(get_nth_value_ptr(this->total_entries()), other.get_nth_value_ptr(start_idx),
+                        nentries * get_value_size());
+        }
+        this->add_entries(nentries);
+        this->inc_gen();
+
+        // If we copied everything from start_idx till end and if its an edge node, need to copy the edge id as well.
+        if (other.has_valid_edge() && ((start_idx + nentries) == other.total_entries())) {
+            this->set_edge_info(other.edge_info());
+        }
+        return nentries;
+    }
+
+    // Space left over by rounding down the capacity is not usable, so it is not reported as available either
+    uint32_t available_size(const BtreeConfig& cfg) const override {
+        return get_available_entries() * get_nth_obj_size(0);
+    }
+
+    uint32_t occupied_size(const BtreeConfig& cfg) const override {
+        return this->total_entries() * get_nth_obj_size(0);
+    }
+
+    data_ranges_t used_data_ranges(const BtreeConfig& cfg) const override {
+        return data_ranges_t{{{0u, sizeof(compact_node_header) + (this->total_entries() * get_key_size())},
+                              {sizeof(compact_node_header) + (capacity() * get_key_size()),
+                               this->total_entries() * get_value_size()}}};
+    }
+
+    void get_nth_key_internal(uint32_t ind, BtreeKey& out_key, bool copy) const override {
+        DEBUG_ASSERT_LT(ind, this->total_entries(), "node={}", to_string());
+        sisl::blob b;
+        b.bytes = const_cast< uint8_t* >(get_nth_key_ptr(ind));
+        b.size = get_key_size();
+        out_key.deserialize(b, copy);
+    }
+
+    std::pair< sisl::blob, sisl::blob > get_nth_kv_blobs(uint32_t ind, std::vector< uint8_t >&) const override {
+        DEBUG_ASSERT_LT(ind, this->total_entries(), "node={}", to_string());
+        return std::make_pair(sisl::blob{const_cast< uint8_t* >(get_nth_key_ptr(ind)), get_key_size()},
+                              sisl::blob{const_cast< uint8_t* >(get_nth_value_ptr(ind)), get_value_size()});
+    }
+
+    void get_nth_value(uint32_t ind, BtreeValue* out_val, bool copy) const override {
+        if (ind == this->total_entries()) {
+            DEBUG_ASSERT_EQ(this->is_leaf(), false, "setting value outside bounds on leaf node");
+            DEBUG_ASSERT_EQ(this->has_valid_edge(), true, "node={}", to_string());
+            *(BtreeLinkInfo*)out_val = this->get_edge_value();
+        } else {
+            sisl::blob b;
+            b.bytes = const_cast< uint8_t* >(get_nth_value_ptr(ind));
+            b.size = get_value_size();
+            out_val->deserialize(b, copy);
+        }
+    }
+
+    std::string to_string(bool print_friendly = false) const override {
+        auto str = fmt::format("{}id={} level={} nEntries={} capacity={} {} next_node={} ",
+                               (print_friendly ? "------------------------------------------------------------\n" : ""),
+                               this->node_id(), this->level(), this->total_entries(), capacity(),
+                               (this->is_leaf() ? "LEAF" : "INTERIOR"), this->next_bnode());
+        if (!this->is_leaf() && (this->has_valid_edge())) {
+            fmt::format_to(std::back_inserter(str), "edge_id={}.{}", this->edge_info().m_bnodeid,
+                           this->edge_info().m_link_version);
+        }
+
+        for (uint32_t i{0}; i < this->total_entries(); ++i) {
+            V val;
+            get_nth_value(i, &val, false);
+            fmt::format_to(std::back_inserter(str), "{}Entry{} [Key={} Val={}]", (print_friendly ? "\n\t" : " "), i + 1,
+                           get_nth_key< K >(i, false).to_string(), val.to_string());
+        }
+        return str;
+    }
+
+    std::string to_string_keys(bool print_friendly = false) const override { return {}; }
+
+    uint8_t* get_node_context() override { return uintptr_cast(this) + sizeof(CompactNode< K, V >); }
+
+#ifndef NDEBUG
+    void validate_sanity() {
+        DEBUG_ASSERT_LE(this->total_entries(), capacity(), "node={}", to_string());
+        for (uint32_t i{1}; i < this->total_entries(); ++i) {
+            if (get_nth_key< K >(i - 1, false).compare(get_nth_key< K >(i, false)) > 0) {
+                DEBUG_ASSERT(false, "non sorted entry at {}, node={}", i, to_string());
+            }
+        }
+    }
+#endif
+
+    uint32_t get_nth_obj_size(uint32_t ind) const override { return get_key_size() + get_value_size(); }
+
+    int compare_nth_key(const BtreeKey& cmp_key, uint32_t ind) const override {
+        return get_nth_key< K >(ind, false).compare(cmp_key);
+    }
+
+    bool find_child_optimistic(const BtreeKey& key, BtreeLinkInfo& child_info) const override {
+        if (this->is_leaf()) { return false; }
+
+        // Writers could be shifting the entries underneath, so search only within the entry count sampled once and
+        // bounded by the capacity, which never changes after the node is initialized.
+        uint32_t const nentries = std::min(this->total_entries(), capacity());
+        uint32_t const end = search_entries(key, nentries).second;
+
+        if (end == nentries) {
+            if (!this->has_valid_edge()) { return false; }
+            child_info = this->get_edge_value();
+        } else {
+            sisl::blob b;
+            b.bytes = const_cast< uint8_t* >(get_nth_value_ptr(end));
+            b.size = BtreeLinkInfo::get_fixed_size();
+            child_info.deserialize(b, true);
+        }
+        return true;
+    }
+
+    std::pair< bool, uint32_t > bsearch_node(const BtreeKey& key) const override {
+        DEBUG_ASSERT_EQ(this->magic(), BTREE_NODE_MAGIC);
+        return search_entries(key, this->total_entries());
+    }
+
+    // Compact node doesn't need a record to point key/value object
+    uint16_t get_record_size() const override { return 0; }
+
+    /////////////// Other Internal Methods /////////////
+    // Search within the first nentries of the key array, without relying on the node header, so it can be used
+    // without node lock
+    std::pair< bool, uint32_t > search_entries(const BtreeKey& key, uint32_t nentries) const {
+        if constexpr (is_integral_btree_key< K >::value) {
+            using key_t = typename K::integral_key_t;
+            auto const b = key.serialize();
+            DEBUG_ASSERT_EQ(b.size, sizeof(key_t), "Integral key size does not match its serialized size");
+            key_t search_key;
+            std::memcpy(&search_key, b.bytes, sizeof(key_t));
+            return key_search::lower_bound< key_t >(get_nth_key_ptr(0), get_key_size(), nentries, search_key);
+        } else {
+            uint32_t first{0};
+            uint32_t len{nentries};
+            K nth_key;
+            sisl::blob b;
+            b.size = get_key_size();
+            while (len > 0) {
+                uint32_t const half = len / 2;
+                b.bytes = const_cast< uint8_t* >(get_nth_key_ptr(first + half));
+                nth_key.deserialize(b, false);
+                if (nth_key.compare(key) < 0) {
+                    first += half + 1;
+                    len -= half + 1;
+                } else {
+                    len = half;
+                }
+            }
+
+            bool found{false};
+            if (first < nentries) {
+                b.bytes = const_cast< uint8_t* >(get_nth_key_ptr(first));
+                nth_key.deserialize(b, false);
+                found = (nth_key.compare(key) == 0);
+            }
+            return std::make_pair(found, first);
+        }
+    }
+
+    void set_nth_obj(uint32_t ind, const BtreeKey& k, const BtreeValue& v) {
+        if (ind > this->total_entries()) {
+            set_nth_value(ind, v);
+        } else {
+            sisl::blob const key_blob = k.serialize();
+            DEBUG_ASSERT_EQ(key_blob.size, get_key_size(), "Invalid key size being set on compact node");
+            std::memcpy(get_nth_key_ptr(ind), key_blob.bytes, key_blob.size);
+
+            sisl::blob const val_blob = v.serialize();
+            DEBUG_ASSERT_EQ(val_blob.size, get_value_size(), "Invalid value size being set on compact node");
+            std::memcpy(get_nth_value_ptr(ind), val_blob.bytes, val_blob.size);
+        }
+    }
+
+    void set_nth_value(uint32_t ind, const BtreeValue& v) {
+        sisl::blob b = v.serialize();
+        if (ind >= this->total_entries()) {
+            RELEASE_ASSERT_EQ(this->is_leaf(), false, "setting value outside bounds on leaf node");
+            DEBUG_ASSERT_EQ(b.size, sizeof(BtreeLinkInfo::bnode_link_info),
+                            "Invalid value size being set for non-leaf node");
+            this->set_edge_info(*r_cast< BtreeLinkInfo::bnode_link_info* >(b.bytes));
+        } else {
+            std::memcpy(get_nth_value_ptr(ind), b.bytes, b.size);
+        }
+    }
+
+    uint32_t capacity() const { return get_compact_node_header_const()->m_capacity; }
+    uint32_t get_available_entries() const { return capacity() - this->total_entries(); }
+
+    static uint32_t get_key_size() { return K::get_fixed_size(); }
+    static uint32_t get_value_size() { return V::get_fixed_size(); }
+
+    uint8_t* get_nth_key_ptr(uint32_t ind) {
+        return this->node_data_area() + sizeof(compact_node_header) + (ind * get_key_size());
+    }
+    const uint8_t* get_nth_key_ptr(uint32_t ind) const {
+        return this->node_data_area_const() + sizeof(compact_node_header) + (ind * get_key_size());
+    }
+
+    uint8_t* get_nth_value_ptr(uint32_t ind) {
+        return this->node_data_area() + sizeof(compact_node_header) + (capacity() * get_key_size()) +
+            (ind * get_value_size());
+    }
+    const uint8_t* get_nth_value_ptr(uint32_t ind) const {
+        return this->node_data_area_const() + sizeof(compact_node_header) + (capacity() * get_key_size()) +
+            (ind * get_value_size());
+    }
+
+private:
+    compact_node_header* get_compact_node_header() {
+        return r_cast< compact_node_header* >(this->node_data_area());
+    }
+    const compact_node_header* get_compact_node_header_const() const {
+        return r_cast< const compact_node_header* >(this->node_data_area_const());
+    }
+};
+} // namespace homestore
@@ -0,0 +1,629 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <vector>
+#include <sisl/logging/logging.h>
+#include "btree_node.hpp"
+#include <homestore/btree/btree_kv.hpp>
+#include "homestore/index/index_internal.hpp"
+
+SISL_LOGGING_DECL(btree)
+
+namespace homestore {
+#pragma pack(1)
+struct prefix_node_header {
+    uint16_t m_data_size;         // Size of the node data area, the prefix is stored at the very end of it
+    uint16_t m_tail_arena_offset; // Tail side of the arena where new suffixes and values are inserted
+    uint16_t m_available_space;
+    uint8_t m_prefix_len; // Length of the prefix stored once for this node
+};
+
+struct prefix_obj_record {
+    uint16_t m_obj_offset : 14;
+    uint16_t reserved : 2;
+    uint16_t m_suffix_len : 14;
+    uint16_t reserved2 : 2;
+    uint16_t m_value_len : 14;
+    uint16_t reserved3 : 2;
+    uint8_t m_prefix_len; // Number of leading bytes of the node prefix which are part of this key
+};
+#pragma pack()
+
+// Internal format of prefix node:
+// [Persistent Header][prefix node header][Record][Record].. ...  ... [suffix][value][suffix][value][prefix]
+//
+// Keys in a node typically share a long common prefix in their serialized form (say volume id followed by an offset).
+// Node stores one such prefix and each record remembers how many bytes of it its key shares, with the rest of the key
+// stored as suffix in the arena. Since every key carries its own shared length, a key which doesn't match the prefix
+// never forces the other keys to be rewritten and the space needed to insert an entry is never more than its
+// uncompressed size. Prefix is picked when the first key lands on an empty node and is re-picked from all the keys
+// whenever a node is filled up by moving or copying entries into it.
+template < typename K, typename V >
+class PrefixNode : public BtreeNode {
+public:
+    static constexpr uint32_t max_prefix_size{std::numeric_limits< uint8_t >::max()};
+
+    PrefixNode(uint8_t* node_buf, bnodeid_t id, bool init, bool is_leaf, const BtreeConfig& cfg) :
+            BtreeNode(node_buf, id, init, is_leaf) {
+        this->set_node_type(btree_node_type::PREFIX);
+        if (init) { reset_area(cfg.node_data_size()); }
+    }
+
+    virtual ~PrefixNode() = default;
+
+    uint32_t occupied_size(const BtreeConfig& cfg) const override {
+        return (cfg.node_data_size() - sizeof(prefix_node_header) - available_size(cfg));
+    }
+
+    data_ranges_t used_data_ranges(const BtreeConfig& cfg) const override {
+        auto const hdr = header_const();
+        return data_ranges_t{{{0u, sizeof(prefix_node_header) + (this->total_entries() * this->get_record_size())},
+                              {hdr->m_tail_arena_offset, hdr->m_data_size - hdr->m_tail_arena_offset}}};
+    }
+
+    /* Insert the key and value in provided index
+     * Assumption: Node lock is already taken */
+    btree_status_t insert(uint32_t ind, const BtreeKey& key, const BtreeValue& val) override {
+        LOGTRACEMOD(btree, "{}:{}", key.to_string(), val.to_string());
+        auto const sz = insert(ind, key.serialize(), val.serialize());
+        RELEASE_ASSERT_NE(sz, 0, "insert failed for key size {} value size {} available size {}",
+                          key.serialized_size(), val.serialized_size(), header_const()->m_available_space);
+#ifndef NDEBUG
+        validate_sanity();
+#endif
+        return btree_status_t::success;
+    }
+
+    void update(uint32_t ind, const BtreeValue& val) override {
+        if (ind == this->total_entries()) {
+            DEBUG_ASSERT_EQ(this->is_leaf(), false);
+            this->set_edge_value(val);
+            this->inc_gen();
+        } else {
+            K key = get_nth_key< K >(ind, true);
+            update(ind, key, val);
+        }
+    }
+
+    void update(uint32_t ind, const BtreeKey& key, const BtreeValue& val) override {
+        DEBUG_ASSERT_LE(ind, this->total_entries());
+        if (ind == this->total_entries()) {
+            DEBUG_ASSERT_EQ(this->is_leaf(), false);
+            this->set_edge_value(val);
+            this->inc_gen();
+            return;
+        }
+
+        sisl::blob const kblob = key.serialize();
+        sisl::blob const vblob = val.serialize();
+        uint8_t const shared = common_prefix_len(kblob);
+        uint16_t const new_obj_size = (kblob.size - shared) + vblob.size;
+        uint16_t const cur_obj_size = get_nth_obj_size(ind);
+
+        if (cur_obj_size >= new_obj_size) {
+            auto rec = get_nth_record_mutable(ind);
+            uint8_t* obj_ptr = offset_to_ptr_mutable(rec->m_obj_offset);
+            std::memmove(obj_ptr, kblob.bytes + shared, kblob.size - shared);
+            std::memmove(obj_ptr + kblob.size - shared, vblob.bytes, vblob.size);
+            rec->m_prefix_len = shared;
+            rec->m_suffix_len = kblob.size - shared;
+            rec->m_value_len = vblob.size;
+            header()->m_available_space += cur_obj_size - new_obj_size;
+            this->inc_gen();
+        } else {
+            remove(ind, ind);
+            insert(ind, key, val);
+            LOGTRACEMOD(btree, "Size changed for either key or value. Had to delete and insert :{}", to_string());
+        }
+    }
+
+    // ind_s and ind_e are inclusive
+    void remove(uint32_t ind_s, uint32_t ind_e) override {
+        uint32_t const total_entries = this->total_entries();
+        DEBUG_ASSERT_GE(total_entries, ind_s);
+        DEBUG_ASSERT_GE(total_entries, ind_e);
+        uint32_t const rec_size = this->get_record_size();
+
+        if (ind_e == total_entries) {
+            DEBUG_ASSERT(!this->is_leaf() && this->has_valid_edge(), "Removing edge of a leaf or invalid edge");
+
+            V last_1_val;
+            get_nth_value(ind_s - 1, &last_1_val, false);
+            this->set_edge_value(last_1_val);
+
+            for (uint32_t i = ind_s - 1; i < total_entries; ++i) {
+                header()->m_available_space += get_nth_obj_size(i) + rec_size;
+            }
+            this->sub_entries(total_entries - ind_s + 1);
+        } else {
+            for (uint32_t i = ind_s; i <= ind_e; ++i) {
+                header()->m_available_space += get_nth_obj_size(i) + rec_size;
+            }
+            uint8_t* rec_ptr = r_cast< uint8_t* >(get_nth_record_mutable(ind_s));
+            std::memmove(rec_ptr, rec_ptr + rec_size * (ind_e - ind_s + 1), (total_entries - ind_e - 1) * rec_size);
+            this->sub_entries(ind_e - ind_s + 1);
+        }
+
+        // Once the node is emptied, next key to be inserted gets to pick the prefix
+        if (this->total_entries() == 0) { reset_area(header_const()->m_data_size); }
+        this->inc_gen();
+    }
+
+    void remove_all(const BtreeConfig& cfg) override {
+        this->sub_entries(this->total_entries());
+        this->invalidate_edge();
+        this->inc_gen();
+        reset_area(cfg.node_data_size());
+    }
+
+    uint32_t move_out_to_right_by_entries(const BtreeConfig& cfg, BtreeNode& o, uint32_t nentries) override {
+        auto const this_nentries = this->total_entries();
+        nentries = std::min(nentries, this_nentries);
+        if (nentries == 0) { return 0; /* Nothing to move */ }
+
+        return move_out_to_right(o, this_nentries - nentries);
+    }
+
+    uint32_t move_out_to_right_by_size(const BtreeConfig& cfg, BtreeNode& o, uint32_t size_to_move) override {
+        if (this->total_entries() == 0) { return 0; }
+
+        // Leave atleast one entry in this node and move the entries from the tail which fits the size
+        uint32_t ind = this->total_entries() - 1;
+        while (ind > 0) {
+            uint32_t const sz = get_nth_obj_size(ind) + this->get_record_size();
+            if (sz > size_to_move) { break; }
+            size_to_move -= sz;
+            --ind;
+        }
+        if (ind + 1 == this->total_entries()) { return 0; }
+
+        return move_out_to_right(o, ind + 1);
+    }
+
+    // Entries could land on a node with a different prefix, so uncompressed size is what it could need at the worst
+    uint32_t num_entries_by_size(uint32_t start_idx, uint32_t size) const override {
+        auto idx = start_idx;
+        uint32_t cum_size{0};
+
+        while (idx < this->total_entries()) {
+            cum_size += this->get_record_size() + get_nth_key_len(idx) + get_nth_value_len(idx);
+            if (cum_size > size) { break; }
+            ++idx;
+        }
+
+        return idx - start_idx;
+    }
+
+    uint32_t copy_by_size(const BtreeConfig& cfg, const BtreeNode& o, uint32_t start_idx, uint32_t copy_size) override {
+        auto& other = static_cast< const PrefixNode& >(o);
+        auto const this_gen = this->node_gen();
+        bool const was_empty = (this->total_entries() == 0);
+        if (was_empty) { adopt_prefix(other); }
+
+        auto idx = start_idx;
+        uint32_t n = 0;
+        std::vector< uint8_t > kbuf;
+        while (idx < other.total_entries()) {
+            sisl::blob const kb = other.copy_nth_key(idx, kbuf);
+            sisl::blob const vb = other.get_nth_value_blob(idx);
+
+            // We reached threshold of how much we could move
+            if (insert_size(kb, vb) > copy_size) { break; }
+
+            auto const sz = insert(this->total_entries(), kb, vb);
+            if (sz == 0) { break; }
+            ++n;
+            ++idx;
+            copy_size -= sz;
+        }
+        if (was_empty) { repick_prefix(); }
+        this->set_gen(this_gen + 1);
+
+        // If we copied everything from start_idx till end and if its an edge node, need to copy the edge id as well.
+        if (other.has_valid_edge() && ((start_idx + n) == other.total_entries())) {
+            this->set_edge_info(other.edge_info());
+        }
+        return n;
+    }
+
+    uint32_t copy_by_entries(const BtreeConfig& cfg, const BtreeNode& o, uint32_t start_idx,
+                             uint32_t nentries) override {
+        auto& other = static_cast< const PrefixNode& >(o);
+        auto const this_gen = this->node_gen();
+        bool const was_empty = (this->total_entries() == 0);
+        if (was_empty) { adopt_prefix(other); }
+
+        nentries = std::min(nentries, other.total_entries() - start_idx);
+        auto idx = start_idx;
+        uint32_t n = 0;
+        std::vector< uint8_t > kbuf;
+        while (n < nentries) {
+            auto const sz = insert(this->total_entries(), other.copy_nth_key(idx, kbuf), other.get_nth_value_blob(idx));
+            if (sz == 0) { break; }
+            ++n;
+            ++idx;
+        }
+        if (was_empty) { repick_prefix(); }
+        this->set_gen(this_gen + 1);
+
+        // If we copied everything from start_idx till end and if its an edge node, need to copy the edge id as well.
+        if (other.has_valid_edge() && ((start_idx + n) == other.total_entries())) {
+            this->set_edge_info(other.edge_info());
+        }
+        return n;
+    }
+
+    void append(uint32_t ind, const BtreeKey& key, const BtreeValue& val) override {
+        RELEASE_ASSERT(false, "Append operation is not supported on prefix node");
+    }
+
+    uint32_t available_size(const BtreeConfig& cfg) const override { return header_const()->m_available_space; }
+
+    uint32_t get_nth_obj_size(uint32_t ind) const override {
+        auto const rec = get_nth_record(ind);
+        return rec->m_suffix_len + rec->m_value_len;
+    }
+
+    uint16_t get_record_size() const override { return sizeof(prefix_obj_record); }
+
+    // Full (uncompressed) length of the nth key
+    uint16_t get_nth_key_len(uint32_t ind) const {
+        auto const rec = get_nth_record(ind);
+        return rec->m_prefix_len + rec->m_suffix_len;
+    }
+    uint16_t get_nth_value_len(uint32_t ind) const { return get_nth_record(ind)->m_value_len; }
+
+    // Key is assembled out of the prefix and suffix on a scratch buffer, so it is always deserialized as a copy
+    // irrespective of what is asked for.
+    void get_nth_key_internal(uint32_t ind, BtreeKey& out_key, bool copy) const override {
+        DEBUG_ASSERT_LT(ind, this->total_entries());
+        static thread_local std::vector< uint8_t > s_key_buf;
+        out_key.deserialize(copy_nth_key(ind, s_key_buf), true);
+    }
+
+    std::pair< sisl::blob, sisl::blob > get_nth_kv_blobs(uint32_t ind, std::vector< uint8_t >& arena) const override {
+        DEBUG_ASSERT_LT(ind, this->total_entries());
+        return std::make_pair(copy_nth_key(ind, arena), get_nth_value_blob(ind));
+    }
+
+    void get_nth_value(uint32_t ind, BtreeValue* out_val, bool copy) const override {
+        if (ind == this->total_entries()) {
+            DEBUG_ASSERT_EQ(this->is_leaf(), false, "get_nth_value out-of-bound");
+            DEBUG_ASSERT_EQ(this->has_valid_edge(), true, "get_nth_value out-of-bound");
+            *(BtreeLinkInfo*)out_val = this->get_edge_value();
+        } else {
+            out_val->deserialize(get_nth_value_blob(ind), copy);
+        }
+    }
+
+    int compare_nth_key(const BtreeKey& cmp_key, uint32_t ind) const override {
+        if constexpr (is_lexicographic_btree_key< K >::value) {
+            // nth key is its shared part of the node prefix followed by its suffix, compare them in place in order
+            auto const rec = get_nth_record(ind);
+            sisl::blob const kblob = cmp_key.serialize();
+            uint32_t const plen = std::min< uint32_t >(rec->m_prefix_len, kblob.size);
+            int x = std::memcmp(prefix_ptr(), kblob.bytes, plen);
+            if ((x == 0) && (plen == rec->m_prefix_len)) {
+                x = std::memcmp(offset_to_ptr(rec->m_obj_offset), kblob.bytes + plen,
+                                std::min< uint32_t >(rec->m_suffix_len, kblob.size - plen));
+            }
+            if (x != 0) { return (x < 0) ? -1 : 1; }
+
+            uint32_t const nth_len = rec->m_prefix_len + rec->m_suffix_len;
+            return (nth_len == kblob.size) ? 0 : ((nth_len < kblob.size) ? -1 : 1);
+        } else {
+            return get_nth_key< K >(ind, false).compare(cmp_key);
+        }
+    }
+
+    std::string to_string(bool print_friendly = false) const override {
+        auto str = fmt::format(
+            "{}id={} level={} nEntries={} {} free_space={} prefix_len={}{} ",
+            (print_friendly ? "---------------------------------------------------------------------\n" : ""),
+            this->node_id(), this->level(), this->total_entries(), (this->is_leaf() ? "LEAF" : "INTERIOR"),
+            header_const()->m_available_space, header_const()->m_prefix_len,
+            (this->next_bnode() == empty_bnodeid) ? "" : fmt::format(" next_node={}", this->next_bnode()));
+        if (!this->is_leaf() && (this->has_valid_edge())) {
+            fmt::format_to(std::back_inserter(str), "edge_id={}.{}", this->edge_info().m_bnodeid,
+                           this->edge_info().m_link_version);
+        }
+        for (uint32_t i{0}; i < this->total_entries(); ++i) {
+            V val;
+            get_nth_value(i, &val, false);
+            fmt::format_to(std::back_inserter(str), "{}Entry{} [Key={} Val={}]", (print_friendly ? "\n\t" : " "), i + 1,
+                           get_nth_key< K >(i, false).to_string(), val.to_string());
+        }
+        return str;
+    }
+
+    std::string to_string_keys(bool print_friendly = false) const override { return {}; }
+
+    uint8_t* get_node_context() override { return uintptr_cast(this) + sizeof(PrefixNode< K, V >); }
+
+#ifndef NDEBUG
+    void validate_sanity() const {
+        uint32_t used{header_const()->m_prefix_len};
+        for (uint32_t i{0}; i < this->total_entries(); ++i) {
+            DEBUG_ASSERT_LE(get_nth_record(i)->m_prefix_len, header_const()->m_prefix_len, "Invalid shared length");
+            used += get_nth_obj_size(i) + this->get_record_size();
+            if (i > 0) {
+                DEBUG_ASSERT_LT(get_nth_key< K >(i - 1, false).compare(get_nth_key< K >(i, false)), 0,
+                                "Found non sorted entry at {} -> {}", i, to_string());
+            }
+        }
+        DEBUG_ASSERT_EQ(used + header_const()->m_available_space,
+                        header_const()->m_data_size - sizeof(prefix_node_header), "Space accounting mismatch {}",
+                        to_string());
+    }
+#endif
+
+protected:
+    uint32_t insert(uint32_t ind, const sisl::blob& key_blob, const sisl::blob& val_blob) {
+        DEBUG_ASSERT_LE(ind, this->total_entries());
+        uint32_t const to_insert_size = insert_size(key_blob, val_blob);
+        if (to_insert_size > header_const()->m_available_space) {
+            LOGTRACEMOD(btree, "insert failed insert size {} available size {}", to_insert_size,
+                        header_const()->m_available_space);
+            return 0;
+        }
+
+        if ((this->total_entries() == 0) && (header_const()->m_prefix_len == 0)) {
+            // Empty node takes the first key as its prefix, entries which follow share as much of it as they can
+            set_prefix(sisl::blob{key_blob.bytes, std::min(key_blob.size, max_prefix_size)});
+        }
+
+        // If we don't have enough space in the tail arena area, we need to compact and get the space.
+        if (to_insert_size > get_arena_free_space()) {
+            compact();
+            DEBUG_ASSERT_LE(to_insert_size, get_arena_free_space(), "We should have space available after compaction");
+        }
+
+        // Create a room for a new record
+        uint8_t* rec_ptr = r_cast< uint8_t* >(get_nth_record_mutable(ind));
+        std::memmove(rec_ptr + this->get_record_size(), rec_ptr,
+                     (this->total_entries() - ind) * this->get_record_size());
+        place_entry(ind, key_blob, val_blob);
+
+        this->inc_entries();
+        this->inc_gen();
+        return to_insert_size;
+    }
+
+    // Space the entry would take in this node, including its record. On an empty node without a prefix, the key would
+    // become the prefix, which is the same as not sharing anything.
+    uint32_t insert_size(const sisl::blob& key_blob, const sisl::blob& val_blob) const {
+        return (key_blob.size - common_prefix_len(key_blob)) + val_blob.size + this->get_record_size();
+    }
+
+    // Moves all entries from start_ind till the end to the front of the other node.
+    uint32_t move_out_to_right(BtreeNode& o, uint32_t start_ind) {
+        auto& other = static_cast< PrefixNode& >(o);
+        auto const this_gen = this->node_gen();
+        auto const other_gen = other.node_gen();
+        bool const other_was_empty = (other.total_entries() == 0);
+        if (other_was_empty) { other.adopt_prefix(*this); }
+        uint32_t const end_ind = this->total_entries() - 1;
+
+        uint32_t nmoved{0};
+        std::vector< uint8_t > kbuf;
+        for (uint32_t ind{start_ind}; ind <= end_ind; ++ind) {
+            if (other.insert(nmoved, copy_nth_key(ind, kbuf), get_nth_value_blob(ind)) == 0) { break; }
+            ++nmoved;
+        }
+        RELEASE_ASSERT_EQ(nmoved, end_ind - start_ind + 1, "Unable to move all entries to right node");
+
+        if (!this->is_leaf() && (other.total_entries() != 0)) {
+            // Incase this node is an edge node, move the stick to the right hand side node
+            other.set_edge_info(this->edge_info());
+            this->invalidate_edge();
+        }
+        remove(start_ind, end_ind);
+
+        // This node keeps its prefix, so that entries moved out could always be moved back in. Other node, if it was
+        // built from scratch, picks the prefix which suits the entries it now has.
+        if (other_was_empty) { other.repick_prefix(); }
+
+        // Remove and insert would have set the gen multiple increments, just reset it to increment only by 1
+        this->set_gen(this_gen + 1);
+        other.set_gen(other_gen + 1);
+        return nmoved;
+    }
+
+    // Rewrite the arena with the same prefix so that available space == tail arena space
+    void compact() {
+        std::vector< uint8_t > prefix{prefix_ptr(), prefix_ptr() + header_const()->m_prefix_len};
+        relayout(sisl::blob{prefix.data(), uint32_cast(prefix.size())});
+        LOGTRACEMOD(btree, "Sparse space reclaimed, available space={}", header_const()->m_available_space);
+    }
+
+    // Pick the longest prefix of the middle key which is shared by atleast half of the keys and switch to it, if that
+    // reduces the space used by this node.
+    void repick_prefix() {
+        uint32_t const nentries = this->total_entries();
+        if (nentries == 0) {
+            reset_area(header_const()->m_data_size);
+            return;
+        }
+
+        std::vector< uint8_t > mid;
+        sisl::blob const mid_blob = copy_nth_key(nentries / 2, mid);
+        std::vector< uint32_t > shared(nentries);
+        for (uint32_t i{0}; i < nentries; ++i) {
+            shared[i] = nth_key_common_prefix_len(i, mid_blob);
+        }
+        auto const nth = shared.begin() + (nentries - 1) / 2;
+        std::nth_element(shared.begin(), nth, shared.end(), std::greater< uint32_t >());
+        uint32_t const new_prefix_len = std::min(*nth, max_prefix_size);
+        sisl::blob const new_prefix{mid.data(), new_prefix_len};
+
+        uint32_t new_size{new_prefix_len};
+        for (uint32_t i{0}; i < nentries; ++i) {
+            new_size += get_nth_key_len(i) - nth_key_common_prefix_len(i, new_prefix) + get_nth_value_len(i) +
+                this->get_record_size();
+        }
+
+        if (new_size < occupied_area()) {
+            LOGTRACEMOD(btree, "Switching prefix_len from {} to {}, used size from {} to {}",
+                        header_const()->m_prefix_len, new_prefix_len, occupied_area(), new_size);
+            relayout(new_prefix);
+        }
+    }
+
+    // Rewrite all the entries against the given prefix. New prefix should not point to this node's buffer.
+    void relayout(const sisl::blob& new_prefix) {
+        auto const hdr = *header_const();
+        uint32_t const nentries = this->total_entries();
+        std::vector< uint8_t > snap{this->node_data_area_const(), this->node_data_area_const() + hdr.m_data_size};
+        uint8_t const* old_prefix = snap.data() + hdr.m_data_size - hdr.m_prefix_len;
+
+        reset_area(hdr.m_data_size);
+        set_prefix(new_prefix);
+
+        std::vector< uint8_t > kbuf;
+        for (uint32_t i{0}; i < nentries; ++i) {
+            auto const rec = r_cast< const prefix_obj_record* >(snap.data() + sizeof(prefix_node_header) +
+                                                                (i * this->get_record_size()));
+            kbuf.resize(rec->m_prefix_len + rec->m_suffix_len);
+            std::memcpy(kbuf.data(), old_prefix, rec->m_prefix_len);
+            std::memcpy(kbuf.data() + rec->m_prefix_len, snap.data() + rec->m_obj_offset, rec->m_suffix_len);
+
+            place_entry(i, sisl::blob{kbuf.data(), uint32_cast(kbuf.size())},
+                        sisl::blob{snap.data() + rec->m_obj_offset + rec->m_suffix_len, rec->m_value_len});
+        }
+#ifndef NDEBUG
+        validate_sanity();
+#endif
+    }
+
+    // Write the entry at the given record slot, taking the space for it from the tail arena
+    void place_entry(uint32_t ind, const sisl::blob& key_blob, const sisl::blob& val_blob) {
+        uint8_t const shared = common_prefix_len(key_blob);
+        uint16_t const obj_size = (key_blob.size - shared) + val_blob.size;
+
+        auto hdr = header();
+        DEBUG_ASSERT_GE(hdr->m_tail_arena_offset, obj_size, "No space in tail arena");
+        hdr->m_tail_arena_offset -= obj_size;
+        hdr->m_available_space -= (obj_size + this->get_record_size());
+
+        auto rec = get_nth_record_mutable(ind);
+        rec->m_obj_offset = hdr->m_tail_arena_offset;
+        rec->m_prefix_len = shared;
+        rec->m_suffix_len = key_blob.size - shared;
+        rec->m_value_len = val_blob.size;
+        rec->reserved = rec->reserved2 = rec->reserved3 = 0;
+
+        uint8_t* raw_data_ptr = offset_to_ptr_mutable(hdr->m_tail_arena_offset);
+        std::memcpy(raw_data_ptr, key_blob.bytes + shared, key_blob.size - shared);
+        std::memcpy(raw_data_ptr + key_blob.size - shared, val_blob.bytes, val_blob.size);
+    }
+
+    // Assemble the full nth key on the provided buffer
+    sisl::blob copy_nth_key(uint32_t ind, std::vector< uint8_t >& buf) const {
+        auto const rec = get_nth_record(ind);
+        buf.resize(rec->m_prefix_len + rec->m_suffix_len);
+        std::memcpy(buf.data(), prefix_ptr(), rec->m_prefix_len);
+        std::memcpy(buf.data() + rec->m_prefix_len, offset_to_ptr(rec->m_obj_offset), rec->m_suffix_len);
+        return sisl::blob{buf.data(), uint32_cast(buf.size())};
+    }
+
+    sisl::blob get_nth_value_blob(uint32_t ind) const {
+        auto const rec = get_nth_record(ind);
+        return sisl::blob{const_cast< uint8_t* >(offset_to_ptr(rec->m_obj_offset)) + rec->m_suffix_len,
+                          rec->m_value_len};
+    }
+
+    // Number of leading bytes the nth key has in common with the given bytes
+    uint32_t nth_key_common_prefix_len(uint32_t ind, const sisl::blob& b) const {
+        auto const rec = get_nth_record(ind);
+        uint32_t n = common_len(prefix_ptr(), b.bytes, std::min< uint32_t >(rec->m_prefix_len, b.size));
+        if (n < rec->m_prefix_len) { return n; }
+        return n +
+            common_len(offset_to_ptr(rec->m_obj_offset), b.bytes + n,
+                       std::min< uint32_t >(rec->m_suffix_len, b.size - n));
+    }
+
+    // Number of leading bytes of the node prefix the given key shares
+    uint8_t common_prefix_len(const sisl::blob& key_blob) const {
+        return uint8_cast(common_len(prefix_ptr(), key_blob.bytes,
+                                     std::min< uint32_t >(header_const()->m_prefix_len, key_blob.size)));
+    }
+
+    static uint32_t common_len(const uint8_t* a, const uint8_t* b, uint32_t len) {
+        return uint32_cast(std::mismatch(a, a + len, b).first - a);
+    }
+
+    // Empty node starts off with the prefix of the node its entries are coming from, so that every entry takes the
+    // same space here as it did there
+    void adopt_prefix(const PrefixNode& other) {
+        reset_area(header_const()->m_data_size);
+        set_prefix(sisl::blob{other.prefix_ptr(), other.header_const()->m_prefix_len});
+    }
+
+    void reset_area(uint16_t data_size) {
+        auto hdr = header();
+        hdr->m_data_size = data_size;
+        hdr->m_prefix_len = 0;
+        hdr->m_tail_arena_offset = data_size;
+        hdr->m_available_space = data_size - sizeof(prefix_node_header);
+    }
+
+    // Expects the arena to be empty
+    void set_prefix(const sisl::blob& prefix) {
+        auto hdr = header();
+        DEBUG_ASSERT_EQ(hdr->m_tail_arena_offset, hdr->m_data_size - hdr->m_prefix_len, "Arena is not empty");
+        hdr->m_available_space += hdr->m_prefix_len;
+        hdr->m_prefix_len = uint8_cast(prefix.size);
+        hdr->m_tail_arena_offset = hdr->m_data_size - prefix.size;
+        hdr->m_available_space -= prefix.size;
+        std::memmove(offset_to_ptr_mutable(hdr->m_tail_arena_offset), prefix.bytes, prefix.size);
+    }
+
+    uint32_t occupied_area() const {
+        return header_const()->m_data_size - sizeof(prefix_node_header) - header_const()->m_available_space;
+    }
+
+    const prefix_obj_record* get_nth_record(uint32_t ind) const {
+        return r_cast< const prefix_obj_record* >(this->node_data_area_const() + sizeof(prefix_node_header) +
+                                                  (ind * this->get_record_size()));
+    }
+    prefix_obj_record* get_nth_record_mutable(uint32_t ind) {
+        return r_cast< prefix_obj_record* >(this->node_data_area() + sizeof(prefix_node_header) +
+                                            (ind * this->get_record_size()));
+    }
+
+    const uint8_t* prefix_ptr() const {
+        return offset_to_ptr(header_const()->m_data_size - header_const()->m_prefix_len);
+    }
+
+    uint8_t* offset_to_ptr_mutable(uint16_t offset) { return this->node_data_area() + offset; }
+    const uint8_t* offset_to_ptr(uint16_t offset) const { return this->node_data_area_const() + offset; }
+
+    prefix_node_header* header() { return r_cast< prefix_node_header* >(this->node_data_area()); }
+    const prefix_node_header* header_const() const {
+        return r_cast< const prefix_node_header* >(this->node_data_area_const());
+    }
+
+    uint16_t get_arena_free_space() const {
+        return header_const()->m_tail_arena_offset - sizeof(prefix_node_header) -
+            (this->total_entries() * this->get_record_size());
+    }
+};
+} // namespace homestore
@@ -18,6 +18,7 @@
 #include <homestore/btree/btree_kv.hpp>
 #include "btree_node.hpp"
 #include "btree_internal.hpp"
+#include "btree_key_search.hpp"
 #include "homestore/index/index_internal.hpp"
 
 using namespace std;
@@ -213,6 +214,10 @@ public:
         return (cfg.node_data_size() - (this->total_entries() * get_nth_obj_size(0)));
     }
 
+    data_ranges_t used_data_ranges(const BtreeConfig& cfg) const override {
+        return data_ranges_t{{{0u, this->total_entries() * get_nth_obj_size(0)}, {0u, 0u}}};
+    }
+
     void get_nth_key_internal(uint32_t ind, BtreeKey& out_key, bool copy) const override {
         DEBUG_ASSERT_LT(ind, this->total_entries(), "node={}", to_string());
         sisl::blob b;
@@ -221,6 +226,13 @@ public:
         out_key.deserialize(b, copy);
     }
 
+    std::pair< sisl::blob, sisl::blob > get_nth_kv_blobs(uint32_t ind, std::vector< uint8_t >&) const override {
+        DEBUG_ASSERT_LT(ind, this->total_entries(), "node={}", to_string());
+        auto const obj = const_cast< uint8_t* >(get_nth_obj_const(ind));
+        return std::make_pair(sisl::blob{obj, get_obj_key_size(ind)},
+                              sisl::blob{obj + get_obj_key_size(ind), get_obj_value_size(ind)});
+    }
+
     void get_nth_value(uint32_t ind, BtreeValue* out_val, bool copy) const override {
         if (ind == this->total_entries()) {
             DEBUG_ASSERT_EQ(this->is_leaf(), false, "setting value outside bounds on leaf node");
@@ -350,6 +362,35 @@ public:
         return get_nth_key< K >(ind, false).compare(cmp_key);
     }
 
+    bool find_child_optimistic(const BtreeKey& key, BtreeLinkInfo& child_info) const override {
+        if (this->is_leaf()) { return false; }
+
+        // Writers could be shifting the entries underneath, so search only within the entry count sampled once and
+        // without any sanity asserts. Fixed size layout guarantees all reads stay within the node.
+        uint32_t const nentries = this->total_entries();
+        uint32_t const end = search_entries(key, nentries).second;
+
+        if (end == nentries) {
+            if (!this->has_valid_edge()) { return false; }
+            child_info = this->get_edge_value();
+        } else {
+            sisl::blob b;
+            b.bytes = const_cast< uint8_t* >(get_nth_obj_const(end) + get_obj_key_size(end));
+            b.size = BtreeLinkInfo::get_fixed_size();
+            child_info.deserialize(b, true);
+        }
+        return true;
+    }
+
+    std::pair< bool, uint32_t > bsearch_node(const BtreeKey& key) const override {
+        if constexpr (is_integral_btree_key< K >::value) {
+            DEBUG_ASSERT_EQ(this->magic(), BTREE_NODE_MAGIC);
+            return search_entries(key, this->total_entries());
+        } else {
+            return BtreeNode::bsearch_node(key);
+        }
+    }
+
     // Simple/Fixed node doesn't need a record to point key/value object
     uint16_t get_record_size() const override { return 0; }
 
@@ -358,6 +399,40 @@ public:
     }*/
 
     /////////////// Other Internal Methods /////////////
+    // Search within the first nentries, without relying on the node header, so it can be used without node lock
+    std::pair< bool, uint32_t > search_entries(const BtreeKey& key, uint32_t nentries) const {
+        if constexpr (is_integral_btree_key< K >::value) {
+            using key_t = typename K::integral_key_t;
+            auto const b = key.serialize();
+            DEBUG_ASSERT_EQ(b.size, sizeof(key_t), "Integral key size does not match its serialized size");
+            key_t search_key;
+            std::memcpy(&search_key, b.bytes, sizeof(key_t));
+            return key_search::lower_bound< key_t >(this->node_data_area_const(), get_nth_obj_size(0), nentries,
+                                                     search_key);
+        } else {
+            int start{-1};
+            int end = int_cast(nentries);
+            while ((end - start) > 1) {
+                int const mid = start + (end - start) / 2;
+                K nth_key;
+                sisl::blob b;
+                b.bytes = const_cast< uint8_t* >(get_nth_obj_const(mid));
+                b.size = get_obj_key_size(mid);
+                nth_key.deserialize(b, false);
+
+                int const x = nth_key.compare(key);
+                if (x == 0) {
+                    return std::make_pair(true, uint32_cast(mid));
+                } else if (x > 0) {
+                    end = mid;
+                } else {
+                    start = mid;
+                }
+            }
+            return std::make_pair(false, uint32_cast(end));
+        }
+    }
+
     void set_nth_obj(uint32_t ind, const BtreeKey& k, const BtreeValue& v) {
         if (ind > this->total_entries()) {
             set_nth_value(ind, v);
@@ -67,6 +67,12 @@ public:
         return (cfg.node_data_size() - sizeof(var_node_header) - available_size(cfg));
     }
 
+    data_ranges_t used_data_ranges(const BtreeConfig& cfg) const override {
+        auto const hdr = get_var_node_header_const();
+        return data_ranges_t{{{0u, sizeof(var_node_header) + (this->total_entries() * this->get_record_size())},
+                              {hdr->m_tail_arena_offset, hdr->m_init_available_space - hdr->m_tail_arena_offset}}};
+    }
+
     /* Insert the key and value in provided index
      * Assumption: Node lock is already taken */
     btree_status_t insert(uint32_t ind, const BtreeKey& key, const BtreeValue& val) override {
@@ -208,94 +214,34 @@ public:
 
     uint32_t move_out_to_right_by_entries(const BtreeConfig& cfg, BtreeNode& o, uint32_t nentries) override {
         auto& other = static_cast< VariableNode& >(o);
-        const auto this_gen = this->node_gen();
-        const auto other_gen = other.node_gen();
-
-        const auto this_nentries = this->total_entries();
-        nentries = std::min(nentries, this_nentries);
+        nentries = std::min(nentries, this->total_entries());
         if (nentries == 0) { return 0; /* Nothing to move */ }
 
-        const uint32_t start_ind = this_nentries - 1;
-        const uint32_t end_ind = this_nentries - nentries;
-        uint32_t ind = start_ind;
-        bool full_move{false};
-        while (ind >= end_ind) {
-            // Get the ith key and value blob and then remove the entry from here and insert to the other node
-            sisl::blob kb;
-            kb.bytes = (uint8_t*)get_nth_obj(ind);
-            kb.size = get_nth_key_len(ind);
-
-            sisl::blob vb;
-            vb.bytes = kb.bytes + kb.size;
-            vb.size = get_nth_value_len(ind);
-
-            auto sz = other.insert(0, kb, vb);
-            if (!sz) { break; }
-            if (ind == 0) {
-                full_move = true;
-                break;
-            }
+        // Pick the entries from the tail, as many as other node can take
+        uint32_t ind = this->total_entries();
+        uint32_t size{0};
+        while (ind > (this->total_entries() - nentries)) {
+            size += get_nth_obj_size(ind - 1) + this->get_record_size();
+            if (size > other.available_size(cfg)) { break; }
             --ind;
         }
-
-        if (!this->is_leaf() && (other.total_entries() != 0)) {
-            // Incase this node is an edge node, move the stick to the right hand side node
-            other.set_edge_info(this->edge_info());
-            this->invalidate_edge();
-        }
-        remove(full_move ? 0u : ind + 1, start_ind); // Remove all entries in bulk
-
-        // Remove and insert would have set the gen multiple increments, just reset it to increment only by 1
-        // TODO: This is bit ugly but needed in-order to avoid repeat the same code again, but see if we can produce
-        // interface around it.
-        this->set_gen(this_gen + 1);
-        other.set_gen(other_gen + 1);
-
-        return (start_ind - ind);
+        return move_out_to_right(other, ind);
     }
 
     uint32_t move_out_to_right_by_size(const BtreeConfig& cfg, BtreeNode& o, uint32_t size_to_move) override {
         auto& other = static_cast< VariableNode& >(o);
-        auto this_gen = this->node_gen();
-        auto other_gen = other.node_gen();
-        uint32_t nmoved{0};
+        if (this->total_entries() == 0) { return 0; }
 
+        // Leave atleast one entry in this node and pick the entries from the tail which fits the size
+        size_to_move = std::min(size_to_move, other.available_size(cfg));
         uint32_t ind = this->total_entries() - 1;
         while (ind > 0) {
-            sisl::blob kb;
-            kb.bytes = (uint8_t*)get_nth_obj(ind);
-            kb.size = get_nth_key_len(ind);
-
-            sisl::blob vb;
-            vb.bytes = kb.bytes + kb.size;
-            vb.size = get_nth_value_len(ind);
-
-            if ((kb.size + vb.size + this->get_record_size()) > size_to_move) {
-                // We reached threshold of how much we could move
-                break;
-            }
-
-            auto sz = other.insert(0, kb, vb); // Keep on inserting on the first index, thus moving everything to right
-
-            --ind;
-            ++nmoved;
+            uint32_t const sz = get_nth_obj_size(ind) + this->get_record_size();
+            if (sz > size_to_move) { break; }
             size_to_move -= sz;
+            --ind;
         }
-        remove(ind + 1, this->total_entries() - 1);
-
-        if (!this->is_leaf() && (other.total_entries() != 0)) {
-            // Incase this node is an edge node, move the stick to the right hand side node
-            other.set_edge_info(this->edge_info());
-            this->invalidate_edge();
-        }
-
-        // Remove and insert would have set the gen multiple increments, just reset it to increment only by 1
-        // TODO: This is bit ugly but needed in-order to avoid repeat the same code again, but see if we can produce
-        // interface around it.
-        this->set_gen(this_gen + 1);
-        other.set_gen(other_gen + 1);
-
-        return nmoved;
+        return move_out_to_right(other, ind + 1);
     }
 
     uint32_t num_entries_by_size(uint32_t start_idx, uint32_t size) const override {
@@ -314,56 +260,16 @@ public:
 
     uint32_t copy_by_size(const BtreeConfig& cfg, const BtreeNode& o, uint32_t start_idx, uint32_t copy_size) override {
         auto& other = static_cast< const VariableNode& >(o);
-        auto this_gen = this->node_gen();
-
-        auto idx = start_idx;
-        uint32_t n = 0;
-        while (idx < other.total_entries()) {
-            sisl::blob kb{(uint8_t*)other.get_nth_obj(idx), other.get_nth_key_len(idx)};
-            sisl::blob vb{kb.bytes + kb.size, other.get_nth_value_len(idx)};
-
-            // We reached threshold of how much we could move
-            if ((kb.size + vb.size + other.get_record_size()) > copy_size) { break; }
-
-            auto sz = insert(this->total_entries(), kb, vb);
-            if (sz == 0) { break; }
-            ++n;
-            ++idx;
-            copy_size -= sz;
-        }
-        this->set_gen(this_gen + 1);
-
-        // If we copied everything from start_idx till end and if its an edge node, need to copy the edge id as well.
-        if (other.has_valid_edge() && ((start_idx + n) == other.total_entries())) {
-            this->set_edge_info(other.edge_info());
-        }
-        return n;
+        auto const n = other.num_entries_by_size(start_idx, std::min(copy_size, available_size(cfg)));
+        return copy_from(other, start_idx, n);
     }
 
     uint32_t copy_by_entries(const BtreeConfig& cfg, const BtreeNode& o, uint32_t start_idx,
                              uint32_t nentries) override {
         auto& other = static_cast< const VariableNode& >(o);
-        auto this_gen = this->node_gen();
-
         nentries = std::min(nentries, other.total_entries() - start_idx);
-        auto idx = start_idx;
-        uint32_t n = 0;
-        while (n < nentries) {
-            sisl::blob kb{(uint8_t*)other.get_nth_obj(idx), other.get_nth_key_len(idx)};
-            sisl::blob vb{kb.bytes + kb.size, other.get_nth_value_len(idx)};
-
-            auto sz = insert(this->total_entries(), kb, vb);
-            if (sz == 0) { break; }
-            ++n;
-            ++idx;
-        }
-        this->set_gen(this_gen + 1);
-
-        // If we copied everything from start_idx till end and if its an edge node, need to copy the edge id as well.
-        if (other.has_valid_edge() && ((start_idx + n) == other.total_entries())) {
-            this->set_edge_info(other.edge_info());
-        }
-        return n;
+        nentries = std::min(nentries, other.num_entries_by_size(start_idx, available_size(cfg)));
+        return copy_from(other, start_idx, nentries);
     }
 
     /*uint32_t move_in_from_right_by_entries(const BtreeConfig& cfg, BtreeNode& o, uint32_t nentries) override {
@@ -481,6 +387,13 @@ public:
         out_key.deserialize(b, copy);
     }
 
+    std::pair< sisl::blob, sisl::blob > get_nth_kv_blobs(uint32_t ind, std::vector< uint8_t >&) const override {
+        assert(ind < this->total_entries());
+        auto const obj = const_cast< uint8_t* >(get_nth_obj(ind));
+        return std::make_pair(sisl::blob{obj, get_nth_key_len(ind)},
+                              sisl::blob{obj + get_nth_key_len(ind), get_nth_value_len(ind)});
+    }
+
     void get_nth_value(uint32_t ind, BtreeValue* out_val, bool copy) const override {
         if (ind == this->total_entries()) {
             DEBUG_ASSERT_EQ(this->is_leaf(), false, "get_nth_value out-of-bound");
@@ -641,73 +554,117 @@ protected:
     }
 
     /*
-     * This method compacts and provides contiguous tail arena space
-     * so that available space == tail arena space
-     * */
-    void compact() {
-#ifndef NDEBUG
-        this->validate_sanity();
-#endif
-        // temp ds to sort records in stack space
-        struct Record {
-            uint16_t m_obj_offset;
-            uint16_t orig_record_index;
-        };
-
-        uint32_t no_of_entries = this->total_entries();
-        if (no_of_entries == 0) {
-            // this happens when  there is only entry and in update, we first remove and than insert
-            get_var_node_header()->m_tail_arena_offset = get_var_node_header()->m_init_available_space;
-            LOGTRACEMOD(btree, "Full available size reclaimed");
-            return;
+     * Inserts the entries [start_idx, start_idx + nentries) of the other node at ind of this node in one pass: room for
+     * all the records is made with one move and the key/values are laid out back to back in the tail arena. Caller
+     * should ensure this node has enough available space for all of them.
+     */
+    void insert_from(uint32_t ind, const VariableNode& other, uint32_t start_idx, uint32_t nentries) {
+        assert(ind <= this->total_entries());
+        uint32_t const rec_size = this->get_record_size();
+        uint32_t obj_size{0};
+        for (auto i{start_idx}; i < start_idx + nentries; ++i) {
+            obj_size += other.get_nth_obj_size(i);
         }
-        std::vector< Record > rec;
-        rec.reserve(no_of_entries);
+        uint32_t const to_insert_size = obj_size + (nentries * rec_size);
+        RELEASE_ASSERT_LE(to_insert_size, get_var_node_header()->available_space(), "Not enough space to insert {}",
+                          nentries);
 
-        uint32_t ind = 0;
-        while (ind < no_of_entries) {
-            btree_obj_record* rec_ptr = (btree_obj_record*)(get_nth_record_mutable(ind));
-            rec[ind].m_obj_offset = rec_ptr->m_obj_offset;
-            rec[ind].orig_record_index = ind;
-            ind++;
+        // If we don't have enough space in the tail arena area, we need to compact and get the space.
+        if (to_insert_size > get_arena_free_space()) {
+            compact();
+            DEBUG_ASSERT_LE(to_insert_size, get_arena_free_space(), "We should have space available after compaction");
         }
 
-        // use comparator to sort based on m_obj_offset in desc order
-        std::sort(rec.begin(), rec.begin() + no_of_entries,
-                  [](Record const& a, Record const& b) -> bool { return b.m_obj_offset < a.m_obj_offset; });
+        // Create a room for all new records
+        uint8_t* rec_ptr = get_nth_record_mutable(ind);
+        std::memmove(rec_ptr + (nentries * rec_size), rec_ptr, (this->total_entries() - ind) * rec_size);
+
+        auto hdr = get_var_node_header();
+        for (auto i{start_idx}; i < start_idx + nentries; ++i, rec_ptr += rec_size) {
+            uint16_t const sz = other.get_nth_obj_size(i);
+            hdr->m_tail_arena_offset -= sz;
+            std::memcpy(offset_to_ptr_mutable(hdr->m_tail_arena_offset), other.get_nth_obj(i), sz);
 
-        uint16_t last_offset = get_var_node_header()->m_init_available_space;
+            // Records of both nodes are of same layout, so take the lengths as is and point it to the new offset
+            std::memcpy(rec_ptr, other.get_nth_record(i), rec_size);
+            set_record_data_offset(rec_ptr, hdr->m_tail_arena_offset);
+        }
+        hdr->m_available_space -= to_insert_size;
+        this->add_entries(nentries);
+    }
 
-        ind = 0;
-        uint16_t sparce_space = 0;
-        // loop records
-        while (ind < no_of_entries) {
-            uint16_t total_key_value_len =
-                get_nth_key_len(rec[ind].orig_record_index) + get_nth_value_len(rec[ind].orig_record_index);
-            sparce_space = last_offset - (rec[ind].m_obj_offset + total_key_value_len);
-            if (sparce_space > 0) {
-                // do compaction
-                uint8_t* old_key_ptr = (uint8_t*)get_nth_obj(rec[ind].orig_record_index);
-                uint8_t* raw_data_ptr = old_key_ptr + sparce_space;
-                memmove(raw_data_ptr, old_key_ptr, total_key_value_len);
+    // Moves out all the entries from start_ind to the head of the other node
+    uint32_t move_out_to_right(VariableNode& other, uint32_t start_ind) {
+        const auto this_gen = this->node_gen();
+        const auto other_gen = other.node_gen();
+        const uint32_t nentries = this->total_entries() - start_ind;
+
+        if (nentries != 0) {
+            other.insert_from(0, *this, start_ind, nentries);
+            if (!this->is_leaf() && (other.total_entries() != 0)) {
+                // Incase this node is an edge node, move the stick to the right hand side node
+                other.set_edge_info(this->edge_info());
+                this->invalidate_edge();
+            }
+            remove(start_ind, this->total_entries() - 1);
+        }
 
-                // update original record
-                btree_obj_record* rec_ptr = (btree_obj_record*)(get_nth_record_mutable(rec[ind].orig_record_index));
-                rec_ptr->m_obj_offset += sparce_space;
+        this->set_gen(this_gen + 1);
+        other.set_gen(other_gen + 1);
+#ifndef NDEBUG
+        other.validate_sanity();
+#endif
+        return nentries;
+    }
 
-                last_offset = rec_ptr->m_obj_offset;
+    // Appends nentries from start_idx of other node to this node
+    uint32_t copy_from(const VariableNode& other, uint32_t start_idx, uint32_t nentries) {
+        auto this_gen = this->node_gen();
+        if (nentries != 0) { insert_from(this->total_entries(), other, start_idx, nentries); }
+        this->set_gen(this_gen + 1);
 
-            } else {
-                assert(sparce_space == 0);
-                last_offset = rec[ind].m_obj_offset;
-            }
-            ind++;
+        // If we copied everything from start_idx till end and if its an edge node, need to copy the edge id as well.
+        if (other.has_valid_edge() && ((start_idx + nentries) == other.total_entries())) {
+            this->set_edge_info(other.edge_info());
         }
-        get_var_node_header()->m_tail_arena_offset = last_offset;
 #ifndef NDEBUG
-        this->validate_sanity();
+        validate_sanity();
 #endif
-        LOGTRACEMOD(btree, "Sparse space reclaimed:{}", sparce_space);
+        return nentries;
+    }
+
+    /*
+     * This method compacts and provides contiguous tail arena space so that available space == tail arena space. The
+     * used part of the arena is copied aside and the key/values laid back from the end of the node in the order of
+     * records, which avoids sorting the records by their offset.
+     * */
+    void compact() {
+        auto hdr = get_var_node_header();
+        uint32_t const no_of_entries = this->total_entries();
+        uint16_t const arena_end = hdr->m_init_available_space;
+        if (no_of_entries == 0) {
+            // this happens when  there is only entry and in update, we first remove and than insert
+            hdr->m_tail_arena_offset = arena_end;
+            LOGTRACEMOD(btree, "Full available size reclaimed");
+            return;
+        }
+
+        static thread_local std::vector< uint8_t > s_arena_copy;
+        uint16_t const arena_start = hdr->m_tail_arena_offset;
+        s_arena_copy.resize(arena_end - arena_start);
+        std::memcpy(s_arena_copy.data(), offset_to_ptr(arena_start), arena_end - arena_start);
+
+        uint16_t last_offset = arena_end;
+        for (uint32_t ind{0}; ind < no_of_entries; ++ind) {
+            auto rec_ptr = r_cast< btree_obj_record* >(get_nth_record_mutable(ind));
+            uint16_t const sz = get_nth_obj_size(ind);
+            last_offset -= sz;
+            std::memcpy(offset_to_ptr_mutable(last_offset), s_arena_copy.data() + (rec_ptr->m_obj_offset - arena_start),
+                        sz);
+            rec_ptr->m_obj_offset = last_offset;
+        }
+        LOGTRACEMOD(btree, "Sparse space reclaimed:{}", last_offset - arena_start);
+        hdr->m_tail_arena_offset = last_offset;
     }
 
     const uint8_t* get_nth_record(uint32_t ind) const {
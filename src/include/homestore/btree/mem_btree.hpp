@@ -14,32 +14,108 @@
  *
  *********************************************************************************/
 #pragma once
+#include <mutex>
+#include <new>
 #include "btree.ipp"
 
 namespace homestore {
+/*
+ * Per tree pool of node buffers. Buffers are carved out of cache line aligned slabs and are recycled through a free
+ * list once the last reference of the node owning them is dropped, so a tree which reached its steady state size does
+ * not go to the heap for node buffers anymore.
+ */
+class MemBtreeNodePool {
+public:
+    static constexpr uint32_t cache_line_size{64};
+    static constexpr uint32_t slab_size{1024 * 1024};
+
+    MemBtreeNodePool(uint32_t node_size) :
+            m_buf_size{((node_size + cache_line_size - 1) / cache_line_size) * cache_line_size},
+            m_bufs_per_slab{std::max(slab_size / m_buf_size, 1u)} {}
+    MemBtreeNodePool(const MemBtreeNodePool&) = delete;
+    MemBtreeNodePool& operator=(const MemBtreeNodePool&) = delete;
+
+    ~MemBtreeNodePool() {
+        DEBUG_ASSERT_EQ(m_free_bufs.size(), m_slabs.size() * m_bufs_per_slab,
+                        "Node buffers are still in use while destroying the pool");
+        for (auto slab : m_slabs) {
+            ::operator delete[](slab, std::align_val_t{cache_line_size});
+        }
+    }
+
+    uint8_t* alloc() {
+        std::unique_lock lg{m_mtx};
+        if (m_free_bufs.empty()) { add_slab(); }
+        auto buf = m_free_bufs.back();
+        m_free_bufs.pop_back();
+        return buf;
+    }
+
+    void free(uint8_t* buf) {
+        std::unique_lock lg{m_mtx};
+        m_free_bufs.push_back(buf);
+    }
+
+    // Installed as the buffer releaser of the nodes, called when the last reference of the node is dropped
+    static void release_buf(void* pool, uint8_t* buf) { static_cast< MemBtreeNodePool* >(pool)->free(buf); }
+
+    uint64_t capacity() const {
+        std::unique_lock lg{m_mtx};
+        return m_slabs.size() * m_bufs_per_slab;
+    }
+
+    uint64_t available() const {
+        std::unique_lock lg{m_mtx};
+        return m_free_bufs.size();
+    }
+
+private:
+    void add_slab() {
+        auto slab = static_cast< uint8_t* >(
+            ::operator new[](uint64_t{m_buf_size} * m_bufs_per_slab, std::align_val_t{cache_line_size}));
+        m_slabs.push_back(slab);
+
+        // Hand out the buffers in the address order, so nodes allocated together are laid out together
+        for (auto i{m_bufs_per_slab}; i > 0; --i) {
+            m_free_bufs.push_back(slab + (uint64_t{i - 1} * m_buf_size));
+        }
+    }
+
+private:
+    const uint32_t m_buf_size;
+    const uint32_t m_bufs_per_slab;
+    mutable std::mutex m_mtx;
+    std::vector< uint8_t* > m_slabs;
+    std::vector< uint8_t* > m_free_bufs;
+};
+
 template < typename K, typename V >
 class MemBtree : public Btree< K, V > {
 private:
-    std::vector< std::shared_ptr< uint8_t[] > > node_buf_ptr_vec;
+    MemBtreeNodePool m_node_pool;
 
 public:
-    MemBtree(const BtreeConfig& cfg) : Btree< K, V >(cfg) {
+    MemBtree(const BtreeConfig& cfg) : Btree< K, V >(cfg), m_node_pool{cfg.node_size()} {
         BT_LOG(INFO, "New {} being created: Node size {}", btree_store_type(), cfg.node_size());
     }
 
     virtual ~MemBtree() {
         const auto [ret, free_node_cnt] = this->destroy_btree(nullptr);
         BT_LOG_ASSERT_EQ(ret, btree_status_t::success, "btree destroy failed");
+
+        // Freed nodes hand back their buffers only after rcu grace period, wait for them before the pool goes away
+        folly::rcu_barrier();
     }
 
     std::string btree_store_type() const override { return "MEM_BTREE"; }
 
+    const MemBtreeNodePool& node_pool() const { return m_node_pool; }
+
 private:
     BtreeNodePtr alloc_node(bool is_leaf) override {
-        std::shared_ptr< uint8_t[] > ptr(new uint8_t[this->m_bt_cfg.node_size()]);
-        node_buf_ptr_vec.emplace_back(ptr);
-
-        auto new_node = this->init_node(ptr.get(), 0u, bnodeid_t{0}, true, is_leaf);
+        auto new_node = this->init_node(m_node_pool.alloc(), 0u, bnodeid_t{0}, true, is_leaf);
+        new_node->m_trans_hdr.buf_releaser = &MemBtreeNodePool::release_buf;
+        new_node->m_trans_hdr.buf_owner = &m_node_pool;
         new_node->set_node_id(bnodeid_t{r_cast< std::uintptr_t >(new_node)});
         new_node->m_refcount.increment();
         return BtreeNodePtr{new_node};
@@ -52,11 +128,21 @@ private:
         return btree_status_t::success;
     }
 
+    btree_status_t read_node_optimistic_impl(bnodeid_t id, BtreeNode*& node) const override {
+        node = r_cast< BtreeNode* >(id);
+        return btree_status_t::success;
+    }
+
+    bool supports_optimistic_read() const override { return true; }
+
     btree_status_t refresh_node(const BtreeNodePtr& node, bool for_read_modify_write, void* context) const override {
         return btree_status_t::success;
     }
 
-    void free_node_impl(const BtreeNodePtr& node, void* context) override { intrusive_ptr_release(node.get()); }
+    // Lock free readers could still be resolving the node, so the last reference is dropped only after they are done
+    void free_node_impl(const BtreeNodePtr& node, void* context) override {
+        folly::rcu_retire(node.get(), [](BtreeNode* n) { intrusive_ptr_release(n); });
+    }
 
     btree_status_t prepare_node_txn(const BtreeNodePtr& parent_node, const BtreeNodePtr& child_node,
                                     void* context) override {
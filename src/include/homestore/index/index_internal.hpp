@@ -15,7 +15,10 @@
  *********************************************************************************/
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <memory>
+#include <vector>
 #include <boost/intrusive_ptr.hpp>
 #include <sisl/utility/atomic_counter.hpp>
 #include <homestore/blk.h>
@@ -68,25 +71,39 @@ struct IndexBuffer;
 typedef std::shared_ptr< IndexBuffer > IndexBufferPtr;
 
 struct IndexBuffer {
-    uint8_t* m_node_buf{nullptr};                            // Actual buffer
-    index_buf_state_t m_buf_state{index_buf_state_t::CLEAN}; // Is buffer yet to persist?
-    BlkId m_blkid;                                           // BlkId where this needs to be persisted
-    std::weak_ptr< IndexBuffer > m_next_buffer;     // Next buffer in the chain
+    uint8_t* m_node_buf{nullptr};                                           // Actual buffer
+    std::atomic< index_buf_state_t > m_buf_state{index_buf_state_t::CLEAN}; // Is buffer yet to persist?
+    BlkId m_blkid;                                                          // BlkId where this needs to be persisted
+
+    // Buffers which can be flushed only after this buffer is persisted. Together with m_wait_for_leaders, these
+    // form a dependency graph per cp, so that unrelated chains can be flushed in parallel.
+    std::vector< std::weak_ptr< IndexBuffer > > m_next_buffers;
+
     // Number of leader buffers we are waiting for before we write this buffer
     sisl::atomic_counter< int > m_wait_for_leaders{0};
 
+    // Parts of the node data area in use as of its last write, checksum is computed only on them when flushed
+    std::array< std::pair< uint32_t, uint32_t >, 2 > m_used_ranges{};
+
     IndexBuffer(BlkId blkid, uint32_t buf_size, uint32_t align_size);
     ~IndexBuffer();
 
     BlkId blkid() const { return m_blkid; }
     uint8_t* raw_buffer() { return m_node_buf; }
 
-    bool is_clean() const { return (m_buf_state == index_buf_state_t::CLEAN); }
+    bool is_clean() const { return (m_buf_state.load() == index_buf_state_t::CLEAN); }
+
+    // Atomically move the buffer from dirty to flushing state. Returns false if someone else has claimed the flush
+    bool try_start_flush() {
+        auto expected = index_buf_state_t::DIRTY;
+        return m_buf_state.compare_exchange_strong(expected, index_buf_state_t::FLUSHING);
+    }
+
     std::string to_string() const {
-        return fmt::format("IndexBuffer {} blkid={} state={} node_buf={} next_buffer={} wait_for={}",
+        return fmt::format("IndexBuffer {} blkid={} state={} node_buf={} num_next_buffers={} wait_for={}",
                            reinterpret_cast< void* >(const_cast< IndexBuffer* >(this)), m_blkid.to_integer(),
-                           static_cast< int >(m_buf_state), static_cast< void* >(m_node_buf),
-                           voidptr_cast(m_next_buffer.lock().get()), m_wait_for_leaders.get());
+                           static_cast< int >(m_buf_state.load()), static_cast< void* >(m_node_buf),
+                           m_next_buffers.size(), m_wait_for_leaders.get());
     }
 };
 
@@ -95,8 +112,10 @@ typedef boost::intrusive_ptr< BtreeNode > BtreeNodePtr;
 
 struct IndexBtreeNode {
 public:
-    IndexBufferPtr m_idx_buf;     // Buffer backing this node
-    cp_id_t m_last_mod_cp_id{-1}; // This node is previously modified by the cp id;
+    IndexBufferPtr m_idx_buf;                  // Buffer backing this node
+    cp_id_t m_last_mod_cp_id{-1};              // This node is previously modified by the cp id;
+    std::atomic< uint32_t > m_evict_skips{0}; // Remaining times the cache evictor should skip this node
+    bool m_pinned{false};                      // Is this node pinned in memory outside the cache evictor
 
 public:
     IndexBtreeNode(const IndexBufferPtr& buf) : m_idx_buf{buf} {}
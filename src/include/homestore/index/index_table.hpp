@@ -32,6 +32,7 @@ template < typename K, typename V >
 class IndexTable : public IndexTableBase, public Btree< K, V > {
 private:
     superblk< index_table_sb > m_sb;
+    bool m_pin_interior_nodes{false};
 
 public:
     IndexTable(uuid_t uuid, uuid_t parent_uuid, uint32_t user_sb_size, const BtreeConfig& cfg,
@@ -72,6 +73,12 @@ public:
     const superblk< index_table_sb >& mutable_super_blk() const { return m_sb; }
     std::string btree_store_type() const override { return "INDEX_BTREE"; }
 
+    // Keep all the interior nodes of this index resident in memory outside of the cache evictor, so that a point
+    // lookup needs at most one device read regardless of cache pressure. Needs to be set before any operation on the
+    // index, nodes which are already cached are not affected.
+    void set_pin_interior_nodes(bool pin) { m_pin_interior_nodes = pin; }
+    bool is_interior_nodes_pinned() const { return m_pin_interior_nodes; }
+
     void update_new_root_info(bnodeid_t root_node, uint64_t version) override {
         m_sb->root_node = root_node;
         m_sb->link_version = version;
@@ -86,6 +93,17 @@ public:
         return Btree< K, V >::put(put_req);
     }
 
+    btree_status_t bulk_load(const std::vector< std::pair< K, V > >& kvs) {
+        return bulk_load(kvs.cbegin(), kvs.cend());
+    }
+
+    // Whole load is done under a single cp, which can be flushed only after the load is complete
+    template < typename InputIt >
+    btree_status_t bulk_load(InputIt first, InputIt last) {
+        auto cpg = hs()->cp_mgr().cp_guard();
+        return Btree< K, V >::bulk_load(first, last, (void*)cpg.context(cp_consumer_t::INDEX_SVC));
+    }
+
     template < typename ReqT >
     btree_status_t remove(ReqT& remove_req) {
         auto cpg = hs()->cp_mgr().cp_guard();
@@ -96,13 +114,15 @@ public:
 protected:
     ////////////////// Override Implementation of underlying store requirements //////////////////
     BtreeNodePtr alloc_node(bool is_leaf) override {
-        return wb_cache().alloc_buf([this, is_leaf](const IndexBufferPtr& idx_buf) -> BtreeNodePtr {
-            BtreeNode* n = this->init_node(idx_buf->raw_buffer(), sizeof(IndexBtreeNode), idx_buf->blkid().to_integer(),
-                                           true, is_leaf);
-            uint8_t* ctx_mem = uintptr_cast(IndexBtreeNode::convert(n));
-            new (ctx_mem) IndexBtreeNode(idx_buf); // TODO: Figure out a way to call destructor of IndexBtreeNode
-            return BtreeNodePtr{n};
-        });
+        return wb_cache().alloc_buf(
+            [this, is_leaf](const IndexBufferPtr& idx_buf) -> BtreeNodePtr {
+                BtreeNode* n = this->init_node(idx_buf->raw_buffer(), sizeof(IndexBtreeNode),
+                                               idx_buf->blkid().to_integer(), true, is_leaf);
+                uint8_t* ctx_mem = uintptr_cast(IndexBtreeNode::convert(n));
+                new (ctx_mem) IndexBtreeNode(idx_buf); // TODO: Figure out a way to call destructor of IndexBtreeNode
+                return BtreeNodePtr{n};
+            },
+            m_pin_interior_nodes && !is_leaf);
     }
 
     void realloc_node(const BtreeNodePtr& node) const {
@@ -119,7 +139,10 @@ protected:
             idx_node->m_last_mod_cp_id = cp_ctx->id();
             LOGTRACEMOD(wbcache, "{}", idx_node->m_idx_buf->to_string());
         }
-        node->set_checksum(this->m_bt_cfg);
+
+        // Checksum is computed once when the buffer is flushed, just note what needs to be covered by it.
+        node->set_checksum_type(this->m_bt_cfg.m_checksum_type);
+        idx_node->m_idx_buf->m_used_ranges = node->used_data_ranges(this->m_bt_cfg);
         return btree_status_t::success;
     }
 
@@ -151,18 +174,44 @@ protected:
 
     btree_status_t read_node_impl(bnodeid_t id, BtreeNodePtr& node) const override {
         try {
-            wb_cache().read_buf(id, node, [this](const IndexBufferPtr& idx_buf) mutable -> BtreeNodePtr {
-                bool is_leaf = BtreeNode::identify_leaf_node(idx_buf->raw_buffer());
-                BtreeNode* n = this->init_node(idx_buf->raw_buffer(), sizeof(IndexBtreeNode),
-                                               idx_buf->blkid().to_integer(), false /* init_buf */, is_leaf);
-                uint8_t* ctx_mem = uintptr_cast(IndexBtreeNode::convert(n));
-                new (ctx_mem) IndexBtreeNode(idx_buf); // TODO: Figure out a way to call destructor of IndexBtreeNode]2
-                return BtreeNodePtr{n};
-            });
+            wb_cache().read_buf(
+                id, node, [this](const IndexBufferPtr& idx_buf) { return verified_node_from_buf(idx_buf); },
+                m_pin_interior_nodes);
             return btree_status_t::success;
         } catch (std::exception& e) { return btree_status_t::read_failed; }
     }
 
+    // Node could have to be read from device and is evicted from cache without waiting for rcu readers
+    bool supports_optimistic_read() const override { return false; }
+
+    void prefetch_node_impl(bnodeid_t id) const override {
+        wb_cache().prefetch_buf(
+            id, [this](const IndexBufferPtr& idx_buf) { return verified_node_from_buf(idx_buf); },
+            m_pin_interior_nodes);
+    }
+
+    // Node read from device is verified before it is put in cache, since it is not verified on later hits
+    BtreeNodePtr verified_node_from_buf(const IndexBufferPtr& idx_buf) const {
+        auto n = node_from_buf(idx_buf);
+#ifndef NO_CHECKSUM
+        if (!n->verify_node(this->m_bt_cfg)) {
+            LOGERROR("CRC Mismatch for node: {} read from device", n->to_string());
+            throw std::runtime_error(fmt::format("CRC mismatch for node={}", n->node_id()));
+        }
+#endif
+        return n;
+    }
+
+    BtreeNodePtr node_from_buf(const IndexBufferPtr& idx_buf) const {
+        bool is_leaf = BtreeNode::identify_leaf_node(idx_buf->raw_buffer());
+        BtreeNode* n = this->init_node(idx_buf->raw_buffer(), sizeof(IndexBtreeNode), idx_buf->blkid().to_integer(),
+                                       false /* init_buf */, is_leaf);
+        uint8_t* ctx_mem = uintptr_cast(IndexBtreeNode::convert(n));
+        // TODO: Figure out a way to call destructor of IndexBtreeNode
+        new (ctx_mem) IndexBtreeNode(idx_buf);
+        return BtreeNodePtr{n};
+    }
+
     btree_status_t refresh_node(const BtreeNodePtr& node, bool for_read_modify_write, void* context) const override {
         CPContext* cp_ctx = (CPContext*)context;
         if (cp_ctx == nullptr) { return btree_status_t::success; }
@@ -193,16 +242,8 @@ protected:
         idx_node->m_last_mod_cp_id = -1;
 
         node->m_phys_node_buf = idx_node->m_idx_buf->raw_buffer();
-        node->set_checksum(this->m_bt_cfg);
 
         LOGTRACEMOD(wbcache, "buf {} ", idx_node->m_idx_buf->to_string());
-
-#ifndef NO_CHECKSUM
-        if (!node->verify_node(this->m_bt_cfg)) {
-            LOGERROR("CRC Mismatch for node: {} after refreshing the cache", node->to_string());
-            return btree_status_t::crc_mismatch;
-        }
-#endif
         return btree_status_t::success;
     }
 
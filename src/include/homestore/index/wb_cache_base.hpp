@@ -36,8 +36,9 @@ public:
     /// @brief Allocate the buffer and initialize the btree node. It adds the node to the wb cache.
     /// @tparam K Key type of the Index
     /// @param node_initializer Callback to be called upon which buffer is turned into btree node
+    /// @param pin If true, node is kept resident in memory outside the cache evictor, until it is freed
     /// @return Node which was created by the node_initializer
-    virtual BtreeNodePtr alloc_buf(node_initializer_t&& node_initializer) = 0;
+    virtual BtreeNodePtr alloc_buf(node_initializer_t&& node_initializer, bool pin = false) = 0;
 
     /// @brief Reallocate the buffer from writeback cache perspective. Typically buffer itself is not modified.
     /// @param buf Buffer to reallocate
@@ -48,7 +49,23 @@ public:
     /// @param context
     virtual void write_buf(const BtreeNodePtr& node, const IndexBufferPtr& buf, CPContext* context) = 0;
 
-    virtual void read_buf(bnodeid_t id, BtreeNodePtr& node, node_initializer_t&& node_initializer) = 0;
+    /// @brief Read the buffer for the given node id, either from cache or from the device. Device read yields the
+    /// calling fiber instead of blocking the reactor and concurrent misses on the same node share a single read.
+    /// @param id Node id of the btree node to read
+    /// @param node [out] Btree node created out of the buffer
+    /// @param node_initializer Callback to be called upon which buffer read from device is turned into btree node
+    /// @param pin_interior If true and the node read from device is an interior node, it is kept resident in memory
+    /// outside the cache evictor, until it is freed
+    /// Throws std::system_error if the read from device fails
+    virtual void read_buf(bnodeid_t id, BtreeNodePtr& node, node_initializer_t&& node_initializer,
+                          bool pin_interior = false) = 0;
+
+    /// @brief Start reading the buffer for the given node id into the cache in the background, if it is not already
+    /// cached or being read. Subsequent read_buf of the node waits for this read instead of issuing its own.
+    /// @param id Node id of the btree node to prefetch
+    /// @param node_initializer Callback to be called upon which buffer read from device is turned into btree node
+    /// @param pin_interior Same as read_buf
+    virtual void prefetch_buf(bnodeid_t id, node_initializer_t&& node_initializer, bool pin_interior = false) = 0;
 
     /// @brief Start a chain of related btree buffers. Typically a chain is creating from second and third pairs and
     /// then first is prepended to the chain. In case the second buffer is already with the WB cache, it will create a
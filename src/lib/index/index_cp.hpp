@@ -15,6 +15,8 @@
  *********************************************************************************/
 #pragma once
 #include <atomic>
+#include <memory>
+#include <vector>
 #include <sisl/fds/thread_vector.hpp>
 #include <homestore/blk.h>
 #include <homestore/index/index_internal.hpp>
@@ -30,6 +32,13 @@ struct flush_buffer_iterator {
     sisl::thread_vector_iterator free_node_list_it;
 };
 
+// Disjoint slice of the dirty buffers of a cp, which is owned by one flush fiber. Buffers are picked from a partition
+// by advancing the cursor atomically, so completions on any thread can pull the next buffer without any lock.
+struct flush_partition {
+    std::vector< IndexBufferPtr > bufs;
+    std::atomic< size_t > next_idx{0};
+};
+
 struct IndexCPContext : public CPContext {
 public:
     std::atomic< uint64_t > m_num_nodes_added{0};
@@ -37,9 +46,13 @@ public:
     sisl::ThreadVector< IndexBufferPtr >* m_dirty_buf_list{nullptr};
     sisl::ThreadVector< BlkId >* m_free_node_blkid_list{nullptr};
     sisl::atomic_counter< int64_t > m_dirty_buf_count{0};
-    IndexBufferPtr m_last_in_chain;
-    std::mutex m_flush_buffer_mtx;
     flush_buffer_iterator m_buf_it;
+    std::unique_ptr< flush_partition[] > m_flush_partitions;
+    uint32_t m_num_flush_partitions{0};
+
+    // Number of contiguous blks which are put in the same flush partition, so that adjacent buffers are flushed by
+    // same fiber.
+    static constexpr uint32_t flush_partition_stripe_blks{256};
 
 public:
     IndexCPContext(cp_id_t cp_id, sisl::ThreadVector< IndexBufferPtr >* dirty_list,
@@ -56,16 +69,30 @@ public:
         m_free_node_blkid_list->clear();
     }
 
-    void prepare_flush_iteration() {
+    void prepare_flush_iteration(uint32_t num_partitions) {
         m_buf_it.dirty_buf_list_it = m_dirty_buf_list->begin(true /* latest */);
         m_buf_it.free_node_list_it = m_free_node_blkid_list->begin(true /* latest */);
+
+        // Distribute the dirty buffers across the partitions by their stripe of blks
+        m_num_flush_partitions = std::max(num_partitions, 1u);
+        m_flush_partitions = std::make_unique< flush_partition[] >(m_num_flush_partitions);
+        IndexBufferPtr* ppbuf;
+        while ((ppbuf = m_dirty_buf_list->next(m_buf_it.dirty_buf_list_it)) != nullptr) {
+            auto& part = m_flush_partitions[partition_of(**ppbuf)];
+            part.bufs.emplace_back(std::move(*ppbuf));
+        }
+    }
+
+    uint32_t partition_of(const IndexBuffer& buf) const {
+        auto const stripe =
+            (uint64_t{buf.m_blkid.chunk_num()} << 32) | (buf.m_blkid.blk_num() / flush_partition_stripe_blks);
+        return s_cast< uint32_t >(std::hash< uint64_t >{}(stripe) % m_num_flush_partitions);
     }
 
     void add_to_dirty_list(const IndexBufferPtr& buf) {
         buf->m_buf_state = index_buf_state_t::DIRTY;
         m_dirty_buf_list->push_back(buf);
         m_dirty_buf_count.increment(1);
-        m_last_in_chain = buf;
         LOGTRACEMOD(wbcache, "{}", buf->to_string());
     }
 
@@ -73,7 +100,22 @@ public:
 
     bool any_dirty_buffers() const { return !m_dirty_buf_count.testz(); }
 
-    IndexBufferPtr* next_dirty() { return m_dirty_buf_list->next(m_buf_it.dirty_buf_list_it); }
+#ifdef _PRERELEASE
+    // Number of buffers to be flushed in this cp, valid once the flush iteration is prepared
+    size_t num_flush_bufs() const {
+        size_t n{0};
+        for (uint32_t i{0}; i < m_num_flush_partitions; ++i) {
+            n += m_flush_partitions[i].bufs.size();
+        }
+        return n;
+    }
+#endif
+
+    IndexBufferPtr* next_dirty(uint32_t partition) {
+        auto& part = m_flush_partitions[partition];
+        auto const idx = part.next_idx.fetch_add(1, std::memory_order_relaxed);
+        return (idx < part.bufs.size()) ? &part.bufs[idx] : nullptr;
+    }
     BlkId* next_blkid() { return m_free_node_blkid_list->next(m_buf_it.free_node_list_it); }
     std::string to_string() const {
         std::string str{
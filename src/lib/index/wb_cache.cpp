@@ -13,6 +13,7 @@
  * specific language governing permissions and limitations under the License.
  *
  *********************************************************************************/
+#include <algorithm>
 #include <sisl/fds/thread_vector.hpp>
 #include <homestore/btree/detail/btree_node.hpp>
 #include <homestore/index_service.hpp>
@@ -35,11 +36,11 @@ IndexWBCache::IndexWBCache(const std::shared_ptr< VirtualDev >& vdev, const std:
                            uint32_t node_size) :
         m_vdev{vdev},
         m_cache{
-            evictor, 100000, node_size,
+            evictor, num_cache_buckets(node_size), node_size,
             [](const BtreeNodePtr& node) -> BlkId { return IndexBtreeNode::convert(node.get())->m_idx_buf->m_blkid; },
             [](const sisl::CacheRecord& rec) -> bool {
                 const auto& hnode = (sisl::SingleEntryHashNode< BtreeNodePtr >&)rec;
-                return (hnode.m_value->m_refcount.test_le(1));
+                return can_evict_node(hnode.m_value.get());
             }},
         m_node_size{node_size} {
     start_flush_threads();
@@ -49,6 +50,34 @@ IndexWBCache::IndexWBCache(const std::shared_ptr< VirtualDev >& vdev, const std:
     }
 }
 
+uint32_t IndexWBCache::num_cache_buckets(uint32_t node_size) {
+    // Size the hash buckets by the number of nodes the cache memory (cache_size_percent) can hold
+    auto const max_nodes = resource_mgr().get_cache_size() / node_size;
+    auto const entries_per_bucket = std::max(HS_DYNAMIC_CONFIG(cache.entries_per_hash_bucket), 1u);
+    return s_cast< uint32_t >(std::max(max_nodes / entries_per_bucket, uint64_t{1024}));
+}
+
+bool IndexWBCache::can_evict_node(BtreeNode* node) {
+    if (!node->m_refcount.test_le(1)) { return false; }
+
+    // Interior nodes which were accessed recently get a few more chances before eviction. Leaf nodes are evicted in
+    // plain LRU order, which makes sure a large scan recycles only the leaf nodes.
+    if (node->is_leaf()) { return true; }
+    auto& skips = IndexBtreeNode::convert(node)->m_evict_skips;
+    auto cur = skips.load(std::memory_order_relaxed);
+    while (cur > 0) {
+        if (skips.compare_exchange_weak(cur, cur - 1, std::memory_order_relaxed)) { return false; }
+    }
+    return true;
+}
+
+void IndexWBCache::touch_node(const BtreeNode* node) {
+    if (!node->is_leaf()) {
+        IndexBtreeNode::convert(const_cast< BtreeNode* >(node))
+            ->m_evict_skips.store(HS_DYNAMIC_CONFIG(cache.btree_interior_node_evict_skips), std::memory_order_relaxed);
+    }
+}
+
 void IndexWBCache::start_flush_threads() {
     // Start WBCache flush threads
     struct Context {
@@ -79,7 +108,7 @@ void IndexWBCache::start_flush_threads() {
     }
 }
 
-BtreeNodePtr IndexWBCache::alloc_buf(node_initializer_t&& node_initializer) {
+BtreeNodePtr IndexWBCache::alloc_buf(node_initializer_t&& node_initializer, bool pin) {
     // Alloc a block of data from underlying vdev
     BlkId blkid;
     auto ret = m_vdev->alloc_contiguous_blks(1, blk_alloc_hints{}, blkid);
@@ -91,18 +120,43 @@ BtreeNodePtr IndexWBCache::alloc_buf(node_initializer_t&& node_initializer) {
     LOGTRACEMOD(wbcache, "idx_buf {} blkid {}", static_cast< void* >(idx_buf.get()), blkid.to_integer());
 
     // Add the node to the cache
-    bool done = m_cache.insert(node);
+    bool done = add_to_cache(node, pin);
     HS_REL_ASSERT_EQ(done, true, "Unable to add alloc'd node to cache, low memory or duplicate inserts?");
     return node;
 }
 
+bool IndexWBCache::get_cached_node(BlkId const& blkid, BtreeNodePtr& node) {
+    auto it = m_pinned_nodes.find(blkid);
+    if (it != m_pinned_nodes.cend()) {
+        node = it->second;
+        return true;
+    }
+
+    if (m_cache.get(blkid, node)) {
+        touch_node(node.get());
+        return true;
+    }
+    return false;
+}
+
+bool IndexWBCache::add_to_cache(const BtreeNodePtr& node, bool pin) {
+    auto idx_node = IndexBtreeNode::convert(node.get());
+    if (pin) {
+        idx_node->m_pinned = true;
+        return m_pinned_nodes.insert(idx_node->m_idx_buf->m_blkid, node).second;
+    } else {
+        touch_node(node.get());
+        return m_cache.insert(node);
+    }
+}
+
 void IndexWBCache::realloc_buf(const IndexBufferPtr& buf) {
     // Commit the blk which was previously allocated
     m_vdev->commit_blk(buf->m_blkid);
 }
 
 void IndexWBCache::write_buf(const BtreeNodePtr& node, const IndexBufferPtr& buf, CPContext* cp_ctx) {
-    m_cache.upsert(node);
+    if (!IndexBtreeNode::convert(node.get())->m_pinned) { m_cache.upsert(node); }
     r_cast< IndexCPContext* >(cp_ctx)->add_to_dirty_list(buf);
     resource_mgr().inc_dirty_buf_size(m_node_size);
 }
@@ -110,42 +164,140 @@ void IndexWBCache::write_buf(const BtreeNodePtr& node, const IndexBufferPtr& buf
 IndexBufferPtr IndexWBCache::copy_buffer(const IndexBufferPtr& cur_buf) const {
     auto new_buf = std::make_shared< IndexBuffer >(cur_buf->m_blkid, m_node_size, m_vdev->align_size());
     std::memcpy(new_buf->raw_buffer(), cur_buf->raw_buffer(), m_node_size);
+    new_buf->m_used_ranges = cur_buf->m_used_ranges; // Copy is flushed with the checksum over the same used portion
     LOGTRACEMOD(wbcache, "new_buf {} cur_buf {} cur_buf_blkid {}", static_cast< void* >(new_buf.get()),
                 static_cast< void* >(cur_buf.get()), cur_buf->m_blkid.to_integer());
     return new_buf;
 }
 
-void IndexWBCache::read_buf(bnodeid_t id, BtreeNodePtr& node, node_initializer_t&& node_initializer) {
+void IndexWBCache::read_buf(bnodeid_t id, BtreeNodePtr& node, node_initializer_t&& node_initializer,
+                            bool pin_interior) {
     auto const blkid = BlkId{id};
 
-retry:
     // Check if the blkid is already in cache, if not load and put it into the cache
-    if (m_cache.get(blkid, node)) { return; }
+    if (get_cached_node(blkid, node)) { return; }
 
-    // Read the buffer from virtual device
-    auto idx_buf = std::make_shared< IndexBuffer >(blkid, m_node_size, m_vdev->align_size());
-    auto raw_buf = idx_buf->raw_buffer();
+    boost::fibers::promise< BtreeNodePtr > read_promise;
+    {
+        std::unique_lock lg(m_pending_reads_mtx);
+
+        // Recheck under lock, since the reader which was in-flight could have inserted into cache by now
+        if (get_cached_node(blkid, node)) { return; }
+
+        auto it = m_pending_reads.find(blkid);
+        if (it != m_pending_reads.end()) {
+            // Someone else is already reading this blkid from device, wait for their read to complete.
+            auto fut = it->second;
+            lg.unlock();
+            LOGTRACEMOD(wbcache, "Waiting for in-flight read of blkid {}", blkid.to_integer());
+            node = fut.get(); // Rethrows the exception, if the in-flight read has failed
+            return;
+        }
+        m_pending_reads.emplace(blkid, read_promise.get_future().share());
+    }
+
+    try {
+        // Read the buffer from virtual device
+        auto idx_buf = std::make_shared< IndexBuffer >(blkid, m_node_size, m_vdev->align_size());
+        auto const err = read_from_vdev(idx_buf->raw_buffer(), blkid);
+        if (err) {
+            throw std::system_error(err, fmt::format("Index node read failed for blkid={}", blkid.to_string()));
+        }
+
+        // Create the btree node out of buffer and push the node into cache. Since any other reader of the same blkid
+        // is waiting on us, there shouldn't be any race on the insert.
+        node = node_initializer(idx_buf);
+        bool done = add_to_cache(node, pin_interior && !node->is_leaf());
+        HS_REL_ASSERT_EQ(done, true, "Unable to add read node to cache, low memory or duplicate inserts?");
+    } catch (...) {
+        {
+            std::unique_lock lg(m_pending_reads_mtx);
+            m_pending_reads.erase(blkid);
+        }
+        read_promise.set_exception(std::current_exception());
+        throw;
+    }
+
+    {
+        std::unique_lock lg(m_pending_reads_mtx);
+        m_pending_reads.erase(blkid);
+    }
+    read_promise.set_value(node);
+}
 
-    m_vdev->sync_read(r_cast< char* >(raw_buf), m_node_size, blkid);
+void IndexWBCache::prefetch_buf(bnodeid_t id, node_initializer_t&& node_initializer, bool pin_interior) {
+    // Readahead is only worth it from io fibers, elsewhere every read is a blocking one anyways
+    if (!iomanager.am_i_sync_io_capable()) { return; }
 
-    // Create the btree node out of buffer
-    node = node_initializer(idx_buf);
+    auto const blkid = BlkId{id};
+    BtreeNodePtr node;
+    if (get_cached_node(blkid, node)) { return; }
 
-    // Push the node into cache
-    bool done = m_cache.insert(node);
-    if (!done) {
-        // There is a race between 2 concurrent reads from vdev and other party won the race. Re-read from cache
-        goto retry;
+    auto read_promise = std::make_shared< boost::fibers::promise< BtreeNodePtr > >();
+    {
+        std::unique_lock lg(m_pending_reads_mtx);
+        if (get_cached_node(blkid, node) || (m_pending_reads.find(blkid) != m_pending_reads.end())) { return; }
+        m_pending_reads.emplace(blkid, read_promise->get_future().share());
     }
+
+    // Read is registered as in-flight, so a reader of this node in the meantime waits for it to complete
+    LOGTRACEMOD(wbcache, "Prefetching blkid {}", blkid.to_integer());
+    auto idx_buf = std::make_shared< IndexBuffer >(blkid, m_node_size, m_vdev->align_size());
+    m_vdev->async_read(r_cast< char* >(idx_buf->raw_buffer()), m_node_size, blkid)
+        .thenValue([this, blkid, idx_buf, read_promise, pin_interior,
+                    initializer = std::move(node_initializer)](std::error_code err) {
+            BtreeNodePtr node;
+            std::exception_ptr eptr;
+            if (err) {
+                eptr = std::make_exception_ptr(
+                    std::system_error(err, fmt::format("Index node read failed for blkid={}", blkid.to_string())));
+            } else {
+                // Buffer which fails verification is dropped and not cached, the waiting readers get the failure
+                try {
+                    node = initializer(idx_buf);
+                } catch (...) { eptr = std::current_exception(); }
+            }
+
+            if (node) {
+                bool done = add_to_cache(node, pin_interior && !node->is_leaf());
+                HS_REL_ASSERT_EQ(done, true, "Unable to add prefetched node to cache, low memory or duplicate insert?");
+            }
+
+            {
+                std::unique_lock lg(m_pending_reads_mtx);
+                m_pending_reads.erase(blkid);
+            }
+            if (eptr) {
+                read_promise->set_exception(eptr);
+            } else {
+                read_promise->set_value(node);
+            }
+        });
+}
+
+std::error_code IndexWBCache::read_from_vdev(uint8_t* raw_buf, BlkId const& blkid) {
+    // If we are not in a fiber which can wait for the io completion (say main loop of the reactor or a non-iomgr
+    // thread), we have no option but to do a blocking read.
+    if (!iomanager.am_i_sync_io_capable()) { return m_vdev->sync_read(r_cast< char* >(raw_buf), m_node_size, blkid); }
+
+    // Issue an async read and yield this fiber until its completion, so that the reactor is free to run other fibers
+    boost::fibers::promise< std::error_code > io_promise;
+    auto io_fut = io_promise.get_future();
+    m_vdev->async_read(r_cast< char* >(raw_buf), m_node_size, blkid)
+        .thenValue([p = std::move(io_promise)](std::error_code err) mutable { p.set_value(err); });
+    return io_fut.get();
 }
 
 std::tuple< bool, bool > IndexWBCache::create_chain(IndexBufferPtr& second, IndexBufferPtr& third, CPContext* cp_ctx) {
     bool second_copied{false}, third_copied{false};
 
+    // If the buffer is already dirty in this cp, the copy is a later version of the same blkid and hence it should
+    // be persisted only after the current version is persisted.
     if (!second->is_clean()) {
         auto new_second = copy_buffer(second);
         LOGTRACEMOD(wbcache, "second copied blkid {} {} new_second {}", second->m_blkid.to_integer(),
                     static_cast< void* >(second.get()), static_cast< void* >(new_second.get()));
+        if (second->m_buf_state == index_buf_state_t::DIRTY) { prepend_to_chain(second, new_second); }
         second = new_second;
         second_copied = true;
     }
@@ -153,6 +305,7 @@ std::tuple< bool, bool > IndexWBCache::create_chain(IndexBufferPtr& second, Inde
         auto new_third = copy_buffer(third);
         LOGTRACEMOD(wbcache, "third copied blkid {} {} new_third {}", third->m_blkid.to_integer(),
                     static_cast< void* >(third.get()), static_cast< void* >(new_third.get()));
+        if (third->m_buf_state == index_buf_state_t::DIRTY) { prepend_to_chain(third, new_third); }
         third = new_third;
         third_copied = true;
     }
@@ -160,27 +313,18 @@ std::tuple< bool, bool > IndexWBCache::create_chain(IndexBufferPtr& second, Inde
     // Append parent(third) to the left child(second).
     prepend_to_chain(second, third);
 
-    // TODO the index buffer are added to end of the chain, instead add to the dependency.
-    auto& last_in_chain = r_cast< IndexCPContext* >(cp_ctx)->m_last_in_chain;
-    if (last_in_chain) {
-        // Add this to the end of the chain.
-        last_in_chain->m_next_buffer = second;
-        second->m_wait_for_leaders.increment(1);
-    }
-
     return {second_copied, third_copied};
 }
 
 void IndexWBCache::prepend_to_chain(const IndexBufferPtr& first, const IndexBufferPtr& second) {
-    assert(first->m_next_buffer.lock() == nullptr);
-    first->m_next_buffer = second;
+    first->m_next_buffers.emplace_back(second);
     second->m_wait_for_leaders.increment(1);
     LOGTRACEMOD(wbcache, "first {} second {}", first->to_string(), second->to_string());
 }
 
 void IndexWBCache::free_buf(const IndexBufferPtr& buf, CPContext* cp_ctx) {
     BtreeNodePtr node;
-    bool done = m_cache.remove(buf->m_blkid, node);
+    bool done = (m_pinned_nodes.erase(buf->m_blkid) == 1) || m_cache.remove(buf->m_blkid, node);
     HS_REL_ASSERT_EQ(done, true, "Race on cache removal of btree blkid?");
 
     resource_mgr().inc_free_blk(m_node_size);
@@ -196,18 +340,17 @@ folly::Future< bool > IndexWBCache::async_cp_flush(CPContext* context) {
         return folly::makeFuture< bool >(true); // nothing to flush
     }
 
-    cp_ctx->prepare_flush_iteration();
+    // Each flush fiber owns a partition of the dirty buffers, so they can all flush in parallel without any
+    // coordination other than the dependencies between the buffers.
+    auto const nfibers = s_cast< uint32_t >(m_cp_flush_fibers.size());
+    cp_ctx->prepare_flush_iteration(nfibers);
 
-    for (auto& fiber : m_cp_flush_fibers) {
-        iomanager.run_on_forget(fiber, [this, cp_ctx]() {
+    for (uint32_t i{0}; i < nfibers; ++i) {
+        iomanager.run_on_forget(m_cp_flush_fibers[i], [this, cp_ctx, i]() {
             static thread_local std::vector< IndexBufferPtr > t_buf_list;
             t_buf_list.clear();
-            get_next_bufs(cp_ctx, resource_mgr().get_dirty_buf_qd(), t_buf_list);
-
-            for (auto& buf : t_buf_list) {
-                do_flush_one_buf(cp_ctx, buf, true);
-            }
-            m_vdev->submit_batch();
+            get_next_bufs(cp_ctx, i, resource_mgr().get_dirty_buf_qd(), nullptr, t_buf_list);
+            do_flush_bufs(cp_ctx, t_buf_list);
         });
     }
     return std::move(cp_ctx->get_future());
@@ -219,81 +362,143 @@ std::unique_ptr< CPContext > IndexWBCache::create_cp_context(cp_id_t cp_id) {
                                               m_free_blkid_list[cp_id_slot].get());
 }
 
+void IndexWBCache::do_flush_bufs(IndexCPContext* cp_ctx, std::vector< IndexBufferPtr >& bufs) {
+    if (bufs.empty()) { return; }
+
+    // Sort the buffers by their device location, so that the buffers on adjacent blks can be written as one io
+    std::sort(bufs.begin(), bufs.end(), [](const IndexBufferPtr& a, const IndexBufferPtr& b) {
+        return (a->m_blkid.chunk_num() != b->m_blkid.chunk_num()) ? (a->m_blkid.chunk_num() < b->m_blkid.chunk_num())
+                                                                   : (a->m_blkid.blk_num() < b->m_blkid.blk_num());
+    });
+
+    auto const max_bufs_per_io = std::clamp(HS_DYNAMIC_CONFIG(generic.cache_flush_max_io_size) / m_node_size, 1u,
+                                            s_cast< uint32_t >(max_blks_per_blkid()));
+    size_t start{0};
+    while (start < bufs.size()) {
+        size_t end{start + 1};
+        while ((end < bufs.size()) && ((end - start) < max_bufs_per_io) &&
+               (bufs[end]->m_blkid.chunk_num() == bufs[start]->m_blkid.chunk_num()) &&
+               (bufs[end]->m_blkid.blk_num() == bufs[end - 1]->m_blkid.blk_num() + 1)) {
+            ++end;
+        }
+
+        if (end - start == 1) {
+            do_flush_one_buf(cp_ctx, bufs[start], true);
+        } else {
+            do_flush_contiguous_bufs(cp_ctx, bufs, start, end);
+        }
+        start = end;
+    }
+    m_vdev->submit_batch();
+}
+
 void IndexWBCache::do_flush_one_buf(IndexCPContext* cp_ctx, const IndexBufferPtr& buf, bool part_of_batch) {
+    // Buffer state is moved to FLUSHING by whoever has picked this buffer to flush
     LOGTRACEMOD(wbcache, "buf {}", buf->to_string());
-    buf->m_buf_state = index_buf_state_t::FLUSHING;
+    set_checksum(buf.get());
     m_vdev->async_write(r_cast< const char* >(buf->raw_buffer()), m_node_size, buf->m_blkid, part_of_batch)
         .thenValue([pbuf = buf.get(), cp_ctx](auto) {
             auto& pthis = s_cast< IndexWBCache& >(wb_cache()); // Avoiding more than 16 bytes capture
-            pthis.process_write_completion(cp_ctx, pbuf);
+            pthis.process_write_completion(cp_ctx, &pbuf, 1u);
         });
 
     if (!part_of_batch) { m_vdev->submit_batch(); }
 }
 
-void IndexWBCache::process_write_completion(IndexCPContext* cp_ctx, IndexBuffer* pbuf) {
-    LOGTRACEMOD(wbcache, "buf {}", pbuf->to_string());
-    resource_mgr().dec_dirty_buf_size(m_node_size);
-    auto [next_buf, has_more] = on_buf_flush_done(cp_ctx, pbuf);
-    if (next_buf) {
-        do_flush_one_buf(cp_ctx, next_buf, false);
-    } else if (!has_more) {
-        // We are done flushing the buffers, lets free the btree blocks and then flush the bitmap
-        free_btree_blks_and_flush(cp_ctx);
+void IndexWBCache::do_flush_contiguous_bufs(IndexCPContext* cp_ctx, const std::vector< IndexBufferPtr >& bufs,
+                                            size_t start, size_t end) {
+    // Buffers and iovs needs to be kept alive until the completion of the write
+    struct flush_io {
+        std::vector< IndexBuffer* > pbufs;
+        std::vector< iovec > iovs;
+    };
+    auto io = std::make_unique< flush_io >();
+    io->pbufs.reserve(end - start);
+    io->iovs.reserve(end - start);
+    for (auto i{start}; i < end; ++i) {
+        LOGTRACEMOD(wbcache, "buf {} coalesced with {} other bufs", bufs[i]->to_string(), end - start - 1);
+        set_checksum(bufs[i].get());
+        io->pbufs.push_back(bufs[i].get());
+        auto& iov = io->iovs.emplace_back();
+        iov.iov_base = bufs[i]->raw_buffer();
+        iov.iov_len = m_node_size;
     }
-}
 
-std::pair< IndexBufferPtr, bool > IndexWBCache::on_buf_flush_done(IndexCPContext* cp_ctx, IndexBuffer* buf) {
-    if (m_cp_flush_fibers.size() > 1) {
-        std::unique_lock lg(m_flush_mtx);
-        return on_buf_flush_done_internal(cp_ctx, buf);
-    } else {
-        return on_buf_flush_done_internal(cp_ctx, buf);
-    }
+    auto const& first_blkid = bufs[start]->m_blkid;
+    BlkId const io_blkid{first_blkid.blk_num(), s_cast< blk_count_t >(end - start), first_blkid.chunk_num()};
+    auto const iovs = io->iovs.data();
+    auto const iovcnt = s_cast< int >(io->iovs.size());
+    m_vdev->async_writev(iovs, iovcnt, io_blkid, true /* part_of_batch */)
+        .thenValue([io = std::move(io), cp_ctx](auto) {
+            auto& pthis = s_cast< IndexWBCache& >(wb_cache());
+            pthis.process_write_completion(cp_ctx, io->pbufs.data(), io->pbufs.size());
+        });
 }
 
-std::pair< IndexBufferPtr, bool > IndexWBCache::on_buf_flush_done_internal(IndexCPContext* cp_ctx, IndexBuffer* buf) {
-    static thread_local std::vector< IndexBufferPtr > t_buf_list;
-    buf->m_buf_state = index_buf_state_t::CLEAN;
+// Buffer is not modified anymore once its flush has started, so checksum is computed only once per flush instead of
+// on every modification of the node.
+void IndexWBCache::set_checksum(IndexBuffer* buf) {
+#ifndef NO_CHECKSUM
+    BtreeNode::set_checksum(buf->raw_buffer(), buf->m_used_ranges);
+#endif
+}
 
-    t_buf_list.clear();
+void IndexWBCache::process_write_completion(IndexCPContext* cp_ctx, IndexBuffer* const* pbufs, size_t nbufs) {
+    resource_mgr().dec_dirty_buf_size(s_cast< uint32_t >(m_node_size * nbufs));
+#ifdef _PRERELEASE
+    if (m_flush_observer) { m_flush_observer(*cp_ctx, pbufs, nbufs); }
+#endif
+
+    std::vector< IndexBufferPtr > next_bufs;
+    bool has_more{true};
+    for (size_t i{0}; i < nbufs; ++i) {
+        LOGTRACEMOD(wbcache, "buf {}", pbufs[i]->to_string());
+        if (!on_buf_flush_done(cp_ctx, pbufs[i], next_bufs)) { has_more = false; }
+    }
 
-    if (cp_ctx->m_dirty_buf_count.decrement_testz()) {
-        return std::make_pair(nullptr, false);
-    } else {
-        get_next_bufs_internal(cp_ctx, 1u, buf, t_buf_list);
-        return std::make_pair((t_buf_list.size() ? t_buf_list[0] : nullptr), true);
+    if (!next_bufs.empty()) {
+        do_flush_bufs(cp_ctx, next_bufs);
+    } else if (!has_more) {
+        // We are done flushing the buffers, lets free the btree blocks and then flush the bitmap
+        free_btree_blks_and_flush(cp_ctx);
     }
 }
 
-void IndexWBCache::get_next_bufs(IndexCPContext* cp_ctx, uint32_t max_count, std::vector< IndexBufferPtr >& bufs) {
-    if (m_cp_flush_fibers.size() > 1) {
-        std::unique_lock lg(m_flush_mtx);
-        get_next_bufs_internal(cp_ctx, max_count, nullptr, bufs);
+bool IndexWBCache::on_buf_flush_done(IndexCPContext* cp_ctx, IndexBuffer* buf, std::vector< IndexBufferPtr >& bufs) {
+    buf->m_buf_state = index_buf_state_t::CLEAN;
+
+    if (cp_ctx->m_dirty_buf_count.decrement_testz()) {
+        return false;
     } else {
-        get_next_bufs_internal(cp_ctx, max_count, nullptr, bufs);
+        // Continue with the partition this buffer belongs to, so that flush load stays spread across the fibers
+        get_next_bufs(cp_ctx, cp_ctx->partition_of(*buf), 1u, buf, bufs);
+        return true;
     }
 }
 
-void IndexWBCache::get_next_bufs_internal(IndexCPContext* cp_ctx, uint32_t max_count, IndexBuffer* prev_flushed_buf,
-                                          std::vector< IndexBufferPtr >& bufs) {
+void IndexWBCache::get_next_bufs(IndexCPContext* cp_ctx, uint32_t partition, uint32_t max_count,
+                                 IndexBuffer* prev_flushed_buf, std::vector< IndexBufferPtr >& bufs) {
     uint32_t count{0};
 
-    // First attempt to execute any follower buffer flush
+    // First attempt to execute all the follower buffers, which are not waiting for any other leaders. Followers could
+    // be more than max_count, but we flush them all, since otherwise no one else is going to pick them up.
     if (prev_flushed_buf) {
-        auto next_buffer = prev_flushed_buf->m_next_buffer.lock();
-        if (next_buffer && next_buffer->m_wait_for_leaders.decrement_testz()) {
-            bufs.emplace_back(next_buffer);
-            ++count;
+        for (auto& next : prev_flushed_buf->m_next_buffers) {
+            auto next_buffer = next.lock();
+            if (next_buffer && next_buffer->m_wait_for_leaders.decrement_testz() && next_buffer->try_start_flush()) {
+                bufs.emplace_back(std::move(next_buffer));
+                ++count;
+            }
         }
+        prev_flushed_buf->m_next_buffers.clear();
     }
 
     // If we still have room to push the next buffer, take it from the main list
     while (count < max_count) {
-        IndexBufferPtr* ppbuf = cp_ctx->next_dirty();
+        IndexBufferPtr* ppbuf = cp_ctx->next_dirty(partition);
         if (ppbuf == nullptr) { break; } // End of list
         IndexBufferPtr buf = *ppbuf;
-        if (buf->m_wait_for_leaders.testz()) {
+        if (buf->m_wait_for_leaders.testz() && buf->try_start_flush()) {
             bufs.emplace_back(std::move(buf));
             ++count;
         } else {
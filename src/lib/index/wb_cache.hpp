@@ -14,8 +14,12 @@
  *
  *********************************************************************************/
 #pragma once
+#include <functional>
 #include <memory>
+#include <unordered_map>
 
+#include <boost/fiber/future.hpp>
+#include <folly/concurrency/ConcurrentHashMap.h>
 #include <iomgr/iomgr.hpp>
 #include <homestore/index/wb_cache_base.hpp>
 #include <homestore/index/index_internal.hpp>
@@ -36,22 +40,37 @@ class IndexWBCache : public IndexWBCacheBase {
 private:
     std::shared_ptr< VirtualDev > m_vdev;
     sisl::SimpleCache< BlkId, BtreeNodePtr > m_cache;
+    folly::ConcurrentHashMap< BlkId, BtreeNodePtr > m_pinned_nodes; // Nodes resident outside the cache evictor
     uint32_t m_node_size;
 
-    // Dirty buffer list arranged in a dependent list fashion
+    // Dirty buffer list per cp, with the flush dependencies between buffers maintained in the buffers themselves
     std::unique_ptr< sisl::ThreadVector< IndexBufferPtr > > m_dirty_list[MAX_CP_COUNT];
     std::unique_ptr< sisl::ThreadVector< BlkId > > m_free_blkid_list[MAX_CP_COUNT]; // Free'd btree blkids per cp
     std::vector< iomgr::io_fiber_t > m_cp_flush_fibers;
-    std::mutex m_flush_mtx;
+
+    // Node reads which are currently in-flight to the device. Concurrent cache misses on the same blkid wait on the
+    // first reader's future instead of issuing their own read.
+    using pending_read_future_t = boost::fibers::shared_future< BtreeNodePtr >;
+    std::mutex m_pending_reads_mtx;
+    std::unordered_map< BlkId, pending_read_future_t > m_pending_reads;
+
+#ifdef _PRERELEASE
+    // Called on completion of every write of cp flush with the buffers written by it, before their followers are
+    // picked up. Used by the tests to validate the order of flush and the coalescing of the writes.
+    using flush_observer_t = std::function< void(const IndexCPContext&, IndexBuffer* const*, size_t) >;
+    flush_observer_t m_flush_observer;
+#endif
 
 public:
     IndexWBCache(const std::shared_ptr< VirtualDev >& vdev, const std::shared_ptr< sisl::Evictor >& evictor,
                  uint32_t node_size);
 
-    BtreeNodePtr alloc_buf(node_initializer_t&& node_initializer) override;
+    BtreeNodePtr alloc_buf(node_initializer_t&& node_initializer, bool pin = false) override;
     void realloc_buf(const IndexBufferPtr& buf) override;
     void write_buf(const BtreeNodePtr& node, const IndexBufferPtr& buf, CPContext* cp_ctx) override;
-    void read_buf(bnodeid_t id, BtreeNodePtr& node, node_initializer_t&& node_initializer) override;
+    void read_buf(bnodeid_t id, BtreeNodePtr& node, node_initializer_t&& node_initializer,
+                  bool pin_interior = false) override;
+    void prefetch_buf(bnodeid_t id, node_initializer_t&& node_initializer, bool pin_interior = false) override;
     std::tuple< bool, bool > create_chain(IndexBufferPtr& second, IndexBufferPtr& third, CPContext* cp_ctx) override;
     void prepend_to_chain(const IndexBufferPtr& first, const IndexBufferPtr& second) override;
     void free_buf(const IndexBufferPtr& buf, CPContext* cp_ctx) override;
@@ -61,16 +80,40 @@ public:
     std::unique_ptr< CPContext > create_cp_context(cp_id_t cp_id);
     IndexBufferPtr copy_buffer(const IndexBufferPtr& cur_buf) const;
 
+#ifdef _PRERELEASE
+    //////////////////// Test only API section /////////////////////////////////
+    void set_flush_observer(flush_observer_t&& observer) { m_flush_observer = std::move(observer); }
+
+    // Runs the check of the cache evictor on the node, which consumes one of its evict skips
+    static bool is_evictable(BtreeNode* node) { return can_evict_node(node); }
+    bool is_node_pinned(bnodeid_t id) const { return (m_pinned_nodes.find(BlkId{id}) != m_pinned_nodes.cend()); }
+    size_t num_pinned_nodes() const { return m_pinned_nodes.size(); }
+    bool is_node_cached(bnodeid_t id) {
+        BtreeNodePtr node;
+        return get_cached_node(BlkId{id}, node);
+    }
+#endif
+
 private:
+    static uint32_t num_cache_buckets(uint32_t node_size);
+    static void touch_node(const BtreeNode* node);
+    bool get_cached_node(BlkId const& blkid, BtreeNodePtr& node);
+    bool add_to_cache(const BtreeNodePtr& node, bool pin);
+
+    // Called by the cache evictor on the node it picked, returns false if the node has to stay in cache for now
+    static bool can_evict_node(BtreeNode* node);
+
     void start_flush_threads();
-    void process_write_completion(IndexCPContext* cp_ctx, IndexBuffer* pbuf);
+    std::error_code read_from_vdev(uint8_t* raw_buf, BlkId const& blkid);
+    static void set_checksum(IndexBuffer* buf);
+    void process_write_completion(IndexCPContext* cp_ctx, IndexBuffer* const* pbufs, size_t nbufs);
+    void do_flush_bufs(IndexCPContext* cp_ctx, std::vector< IndexBufferPtr >& bufs);
     void do_flush_one_buf(IndexCPContext* cp_ctx, const IndexBufferPtr& buf, bool part_of_batch);
-    std::pair< IndexBufferPtr, bool > on_buf_flush_done(IndexCPContext* cp_ctx, IndexBuffer* buf);
-    std::pair< IndexBufferPtr, bool > on_buf_flush_done_internal(IndexCPContext* cp_ctx, IndexBuffer* buf);
-
-    void get_next_bufs(IndexCPContext* cp_ctx, uint32_t max_count, std::vector< IndexBufferPtr >& bufs);
-    void get_next_bufs_internal(IndexCPContext* cp_ctx, uint32_t max_count, IndexBuffer* prev_flushed_buf,
-                                std::vector< IndexBufferPtr >& bufs);
+    void do_flush_contiguous_bufs(IndexCPContext* cp_ctx, const std::vector< IndexBufferPtr >& bufs, size_t start,
+                                  size_t end);
+    bool on_buf_flush_done(IndexCPContext* cp_ctx, IndexBuffer* buf, std::vector< IndexBufferPtr >& bufs);
+    void get_next_bufs(IndexCPContext* cp_ctx, uint32_t partition, uint32_t max_count, IndexBuffer* prev_flushed_buf,
+                       std::vector< IndexBufferPtr >& bufs);
     void free_btree_blks_and_flush(IndexCPContext* cp_ctx);
 
 };
@@ -0,0 +1,124 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+#include <cstdint>
+#include <map>
+#include <memory>
+
+#include <benchmark/benchmark.h>
+#include <boost/fiber/all.hpp>
+#include <sisl/logging/logging.h>
+#include <sisl/options/options.h>
+#include <homestore/btree/mem_btree.hpp>
+#include "btree_test_kvs.hpp"
+
+using namespace homestore;
+SISL_LOGGING_INIT(btree, iomgr, io_wd, flip)
+SISL_OPTIONS_ENABLE(logging)
+
+static constexpr uint32_t g_node_size{4096};
+
+// Exposes the btree lock tracking, which looks up the fiber local btree variables on every call
+struct BenchBtree : public MemBtree< TestFixedKey, TestFixedValue > {
+    using MemBtree< TestFixedKey, TestFixedValue >::MemBtree;
+    using Btree< TestFixedKey, TestFixedValue >::alloc_leaf_node;
+    using Btree< TestFixedKey, TestFixedValue >::free_node;
+    using Btree< TestFixedKey, TestFixedValue >::_start_of_lock;
+    using Btree< TestFixedKey, TestFixedValue >::remove_locked_node;
+};
+
+// Lookup of the btree variables used earlier, keyed by fiber id in a thread local map which is never trimmed
+static std::map< boost::fibers::fiber::id, std::unique_ptr< BtreeThreadVariables > >& fiber_map() {
+    static thread_local std::map< boost::fibers::fiber::id, std::unique_ptr< BtreeThreadVariables > > s_fiber_map;
+    return s_fiber_map;
+}
+
+static BtreeThreadVariables* map_thread_vars() {
+    auto this_id(boost::this_fiber::get_id());
+    auto& fmap = fiber_map();
+    if (fmap.count(this_id)) { return fmap[this_id].get(); }
+    fmap[this_id] = std::make_unique< BtreeThreadVariables >();
+    return fmap[this_id].get();
+}
+
+// Runs the given number of short lived fibers on this thread, each of them looking up its btree variables the way the
+// btree operations do. Only the map lookup keeps anything around after the fiber exits. The number of entries it
+// retains depends on how many fiber ids get reused and is reported as is.
+static void run_fibers(BenchBtree& bt, uint32_t num_fibers) {
+    for (uint32_t i{0}; i < num_fibers; ++i) {
+        boost::fibers::fiber([&bt]() {
+            auto node = bt.alloc_leaf_node();
+            btree_locked_node_info info;
+            BenchBtree::_start_of_lock(node, locktype_t::READ, __FILE__, __LINE__);
+            BenchBtree::remove_locked_node(node, locktype_t::READ, &info);
+            bt.free_node(node, locktype_t::NONE, nullptr);
+            map_thread_vars();
+        }).join();
+    }
+}
+
+// Lock tracking as done by the btree on every node lock and unlock, through its own fiber local variables
+static void lock_tracking_fiber_vars(benchmark::State& state) {
+    BtreeConfig cfg{g_node_size};
+    BenchBtree bt{cfg};
+    bt.init(nullptr);
+    run_fibers(bt, s_cast< uint32_t >(state.range(0)));
+
+    auto node = bt.alloc_leaf_node();
+    btree_locked_node_info info;
+    for (auto _ : state) {
+        BenchBtree::_start_of_lock(node, locktype_t::WRITE, __FILE__, __LINE__);
+        benchmark::DoNotOptimize(BenchBtree::remove_locked_node(node, locktype_t::WRITE, &info));
+    }
+    bt.free_node(node, locktype_t::NONE, nullptr);
+    state.counters["map_entries"] = fiber_map().size();
+    fiber_map().clear();
+}
+
+// Same lock tracking, but with the variables looked up from the fiber id keyed map
+static void lock_tracking_fiber_map(benchmark::State& state) {
+    BtreeConfig cfg{g_node_size};
+    BenchBtree bt{cfg};
+    bt.init(nullptr);
+    run_fibers(bt, s_cast< uint32_t >(state.range(0)));
+
+    auto node = bt.alloc_leaf_node();
+    btree_locked_node_info info;
+    for (auto _ : state) {
+        info.start_time = Clock::now();
+        info.node = node.get();
+        map_thread_vars()->wr_locked_nodes.push_back(info);
+
+        auto& locked_nodes = map_thread_vars()->wr_locked_nodes;
+        bool found = (!locked_nodes.empty() && (locked_nodes.back().node == node.get()));
+        if (found) { locked_nodes.pop_back(); }
+        benchmark::DoNotOptimize(found);
+    }
+    bt.free_node(node, locktype_t::NONE, nullptr);
+    state.counters["map_entries"] = fiber_map().size();
+    fiber_map().clear();
+}
+
+BENCHMARK(lock_tracking_fiber_vars)->Arg(0)->Arg(1000)->Arg(10000);
+BENCHMARK(lock_tracking_fiber_map)->Arg(0)->Arg(1000)->Arg(10000);
+
+int main(int argc, char** argv) {
+    ::benchmark::Initialize(&argc, argv);
+    SISL_OPTIONS_LOAD(argc, argv, logging)
+    sisl::logging::SetLogger("btree_lock_benchmark");
+    spdlog::set_pattern("[%D %T%z] [%^%l%$] [%n] [%t] %v");
+
+    ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -63,6 +63,8 @@ private:
     uint32_t m_key{0};
 
 public:
+    using integral_key_t = uint32_t;
+
     TestFixedKey() = default;
     TestFixedKey(uint32_t k) : m_key{k} {}
     TestFixedKey(const TestFixedKey& other) : TestFixedKey(other.serialize(), true) {}
@@ -153,6 +155,9 @@ private:
     }
 
 public:
+    // Key string starts with the key as zero filled hex digits, so the strings sort the same way as the keys
+    using lexicographic_key_t = void;
+
     TestVarLenKey() = default;
     TestVarLenKey(uint32_t k) : BtreeKey(), m_key{k} {}
     TestVarLenKey(const BtreeKey& other) : TestVarLenKey(other.serialize(), true) {}
@@ -14,6 +14,8 @@
  *
  *********************************************************************************/
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <numeric>
 #include <random>
 #include <map>
 #include <memory>
@@ -23,6 +25,8 @@
 #include <sisl/utility/enum.hpp>
 #include <homestore/btree/detail/simple_node.hpp>
 #include <homestore/btree/detail/varlen_node.hpp>
+#include <homestore/btree/detail/prefix_node.hpp>
+#include <homestore/btree/detail/compact_node.hpp>
 #include "btree_test_kvs.hpp"
 
 static constexpr uint32_t g_node_size{4096};
@@ -56,6 +60,50 @@ struct VarObjSizeNodeTest {
     using ValueType = TestVarLenValue;
 };
 
+struct PrefixNodeTest {
+    using NodeType = PrefixNode< TestVarLenKey, TestVarLenValue >;
+    using KeyType = TestVarLenKey;
+    using ValueType = TestVarLenValue;
+};
+
+struct CompactNodeTest {
+    using NodeType = CompactNode< TestFixedKey, TestFixedValue >;
+    using KeyType = TestFixedKey;
+    using ValueType = TestFixedValue;
+};
+
+// Key of the kind an index keeps, id of the volume followed by an offset within it. All keys of a volume share the long
+// volume id, and the offset is zero filled hex digits, so the key strings sort the same way as the keys.
+class TestVolOffsetKey : public BtreeKey {
+private:
+    std::string m_str;
+
+public:
+    using lexicographic_key_t = void;
+    static constexpr uint32_t vol_id_size{56};
+
+    TestVolOffsetKey() = default;
+    TestVolOffsetKey(uint32_t vol, uint32_t offset) :
+            m_str{fmt::format("{:0>{}}{:08x}", vol, vol_id_size, offset)} {}
+    TestVolOffsetKey(const sisl::blob& b, bool copy) : BtreeKey() { deserialize(b, copy); }
+    TestVolOffsetKey(const TestVolOffsetKey& other) = default;
+    TestVolOffsetKey& operator=(const TestVolOffsetKey& other) = default;
+    virtual ~TestVolOffsetKey() = default;
+
+    void clone(const BtreeKey& other) override { m_str = s_cast< const TestVolOffsetKey& >(other).m_str; }
+    int compare(const BtreeKey& o) const override { return m_str.compare(s_cast< const TestVolOffsetKey& >(o).m_str); }
+
+    sisl::blob serialize() const override {
+        return sisl::blob{r_cast< uint8_t* >(const_cast< char* >(m_str.data())), uint32_cast(m_str.size())};
+    }
+    uint32_t serialized_size() const override { return uint32_cast(m_str.size()); }
+    void deserialize(const sisl::blob& b, bool copy) override { m_str.assign(r_cast< const char* >(b.bytes), b.size); }
+    static bool is_fixed_size() { return false; }
+    static uint32_t get_estimate_max_size() { return vol_id_size + 8; }
+
+    std::string to_string() const override { return m_str; }
+};
+
 template < typename TestType >
 struct NodeTest : public testing::Test {
     using T = TestType;
@@ -263,7 +311,8 @@ private:
     }
 };
 
-using NodeTypes = testing::Types< FixedLenNodeTest, VarKeySizeNodeTest, VarValueSizeNodeTest, VarObjSizeNodeTest >;
+using NodeTypes = testing::Types< FixedLenNodeTest, VarKeySizeNodeTest, VarValueSizeNodeTest, VarObjSizeNodeTest,
+                                 PrefixNodeTest, CompactNodeTest >;
 TYPED_TEST_SUITE(NodeTest, NodeTypes);
 
 TYPED_TEST(NodeTest, SequentialInsert) {
@@ -386,6 +435,115 @@ TYPED_TEST(NodeTest, Move) {
     this->validate_key_order();
 }
 
+TYPED_TEST(NodeTest, Checksum) {
+    this->put_list({0, 1, 2, g_max_keys / 2, g_max_keys / 2 + 1, g_max_keys / 2 - 1});
+    auto const ranges = this->m_node1->used_data_ranges(this->m_cfg);
+    uint8_t* data_area = this->m_node1_buf.get() + sizeof(persistent_hdr_t);
+
+    for (auto const type :
+         {btree_checksum_type::CRC16_T10DIF, btree_checksum_type::CRC32C, btree_checksum_type::FARMHASH}) {
+        this->m_node1->set_checksum_type(type);
+        this->m_node1->set_checksum(this->m_cfg);
+        ASSERT_EQ(this->m_node1->verify_node(this->m_cfg), true) << "Checksum mismatch on unmodified node";
+
+        // Corrupting the used part of the node should be caught
+        uint8_t* used_byte = data_area + ranges[0].first + ranges[0].second - 1;
+        *used_byte = ~(*used_byte);
+        ASSERT_EQ(this->m_node1->verify_node(this->m_cfg), false) << "Corruption of the node is not detected";
+        *used_byte = ~(*used_byte);
+
+        // Free space is not covered by the checksum
+        auto const free_offset = ranges[0].first + ranges[0].second;
+        if ((free_offset < this->m_cfg.node_data_size()) &&
+            ((free_offset < ranges[1].first) || (free_offset >= ranges[1].first + ranges[1].second))) {
+            data_area[free_offset] = ~data_area[free_offset];
+            ASSERT_EQ(this->m_node1->verify_node(this->m_cfg), true) << "Free space of the node is checksummed";
+        }
+    }
+
+    // Unknown checksum type should not be taken as a match, even with a zero checksum
+    auto hdr = r_cast< persistent_hdr_t* >(this->m_node1_buf.get());
+    hdr->checksum_type = 0xff;
+    hdr->checksum = 0;
+    ASSERT_EQ(this->m_node1->verify_node(this->m_cfg), false) << "Node with unknown checksum type is verified";
+
+    // Node in version 1 format has crc16 of the whole data area in place of the checksum type
+    uint16_t const v1_checksum = crc16_t10dif(bt_init_crc_16, data_area, this->m_cfg.node_data_size());
+    hdr->version = BTREE_NODE_VERSION_V1;
+    std::memcpy(&hdr->checksum_type, &v1_checksum, sizeof(v1_checksum));
+    ASSERT_EQ(this->m_node1->verify_node(this->m_cfg), true) << "Checksum mismatch on version 1 node";
+    data_area[ranges[0].first] = ~data_area[ranges[0].first];
+    ASSERT_EQ(this->m_node1->verify_node(this->m_cfg), false) << "Corruption of version 1 node is not detected";
+    data_area[ranges[0].first] = ~data_area[ranges[0].first];
+
+    // Writing it again moves the node to the current format
+    this->m_node1->set_checksum_type(btree_checksum_type::CRC32C);
+    this->m_node1->set_checksum(this->m_cfg);
+    ASSERT_EQ(this->m_node1->version(), BTREE_NODE_VERSION) << "Node is not moved to the current format";
+    ASSERT_EQ(this->m_node1->verify_node(this->m_cfg), true) << "Checksum mismatch on node moved to current format";
+}
+
+// Keys sharing a long prefix should take a fraction of the space in a prefix node of what they take in a var key node,
+// and be found there through the in place compare of prefix and suffix bytes.
+TEST(PrefixNodeTest, LongSharedPrefix) {
+    using PrefixNodeType = PrefixNode< TestVolOffsetKey, TestFixedValue >;
+    using VarKeyNodeType = VarKeySizeNode< TestVolOffsetKey, TestFixedValue >;
+    static constexpr uint32_t vol{42};
+
+    BtreeConfig cfg{g_node_size};
+    cfg.set_node_data_size(cfg.node_size() - sizeof(persistent_hdr_t));
+    auto prefix_buf = std::unique_ptr< uint8_t[] >(new uint8_t[g_node_size]);
+    auto varkey_buf = std::unique_ptr< uint8_t[] >(new uint8_t[g_node_size]);
+    PrefixNodeType prefix_node{prefix_buf.get(), 1ul, true, true, cfg};
+    VarKeyNodeType varkey_node{varkey_buf.get(), 2ul, true, true, cfg};
+
+    std::vector< uint32_t > offsets(g_max_keys);
+    std::iota(offsets.begin(), offsets.end(), 0);
+    std::shuffle(offsets.begin(), offsets.end(), g_re);
+
+    // Insert in random order till the node can't take an entry of its uncompressed size
+    auto const fill = [&cfg, &offsets](BtreeNode& node) {
+        uint32_t n{0};
+        for (auto const offset : offsets) {
+            TestVolOffsetKey key{vol, offset};
+            TestFixedValue val{offset};
+            if (node.available_size(cfg) < key.serialized_size() + val.serialized_size() + 16) { break; }
+            EXPECT_EQ(node.put(key, val, btree_put_type::INSERT_ONLY_IF_NOT_EXISTS, nullptr), true);
+            ++n;
+        }
+        return n;
+    };
+    auto const num_prefix_entries = fill(prefix_node);
+    auto const num_varkey_entries = fill(varkey_node);
+    LOGINFO("Entries per node with {} byte shared prefix: prefix node={} var key node={}",
+            TestVolOffsetKey::vol_id_size, num_prefix_entries, num_varkey_entries);
+    ASSERT_EQ(prefix_node.total_entries(), num_prefix_entries);
+    ASSERT_GE(num_prefix_entries, 2 * num_varkey_entries) << "Prefix node is not storing the shared prefix once";
+
+    for (uint32_t i{0}; i < num_prefix_entries; ++i) {
+        TestFixedValue val;
+        ASSERT_EQ(prefix_node.find(TestVolOffsetKey{vol, offsets[i]}, &val, true).first, true)
+            << "Inserted offset " << offsets[i] << " is not found in prefix node";
+        ASSERT_EQ(val.value(), offsets[i]);
+    }
+    for (uint32_t i{1}; i < num_prefix_entries; ++i) {
+        ASSERT_LT(prefix_node.get_nth_key< TestVolOffsetKey >(i - 1, true)
+                      .compare(prefix_node.get_nth_key< TestVolOffsetKey >(i, true)),
+                  0)
+            << "Prefix node keys are not sorted at " << i;
+    }
+    for (uint32_t i{num_prefix_entries}; i < g_max_keys; ++i) {
+        ASSERT_EQ(prefix_node.find(TestVolOffsetKey{vol, offsets[i]}, nullptr, false).first, false)
+            << "Offset " << offsets[i] << " which is not inserted is found in prefix node";
+    }
+
+    // Keys which part from the shared prefix sort entirely before or after the keys of the volume
+    ASSERT_EQ(prefix_node.find(TestVolOffsetKey{vol - 1, g_max_keys}, nullptr, false),
+              std::make_pair(false, uint32_t{0}));
+    ASSERT_EQ(prefix_node.find(TestVolOffsetKey{vol + 1, 0}, nullptr, false),
+              std::make_pair(false, prefix_node.total_entries()));
+}
+
 SISL_OPTIONS_ENABLE(logging, test_btree_node)
 SISL_OPTION_GROUP(test_btree_node,
                   (num_iters, "", "num_iters", "number of iterations for rand ops",
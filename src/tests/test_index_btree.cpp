@@ -15,12 +15,20 @@
  *********************************************************************************/
 
 #include <random>
+#include <array>
 #include <map>
+#include <set>
 #include <memory>
+#include <optional>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
 #include <gtest/gtest.h>
 #include <boost/uuid/random_generator.hpp>
+#include <boost/fiber/all.hpp>
 
 #include <iomgr/io_environment.hpp>
+#include <iomgr/iomgr_flip.hpp>
 #include <sisl/options/options.h>
 #include <sisl/logging/logging.h>
 #include <sisl/utility/enum.hpp>
@@ -31,6 +39,7 @@
 #include <homestore/index/index_table.hpp>
 #include "common/homestore_config.hpp"
 #include "common/resource_mgr.hpp"
+#include "index/wb_cache.hpp"
 #include "test_common/homestore_test_common.hpp"
 
 using namespace homestore;
@@ -82,6 +91,50 @@ struct VarObjSizeBtreeTest {
     static constexpr btree_node_type interior_node_type = btree_node_type::VAR_OBJECT;
 };
 
+// Exposes the node construction of the index table, so that the tests can drive the reads of wb cache directly
+template < typename IndexTableT >
+struct IndexTableAccess : public IndexTableT {
+    static BtreeNodePtr make_node(const IndexTableT& bt, const IndexBufferPtr& buf) {
+        return (bt.*(&IndexTableAccess::node_from_buf))(buf);
+    }
+};
+
+#ifdef _PRERELEASE
+// Tracks the buffers written by the cp flushes, through the flush observer of wb cache
+struct FlushTracker {
+    struct cp_flush_info {
+        size_t num_flush_bufs{0};
+        std::unordered_map< const IndexBuffer*, uint32_t > writes; // Number of times each buffer is written
+        std::set< uint32_t > partitions;                            // Flush partitions of the written buffers
+    };
+
+    std::mutex mtx;
+    std::map< cp_id_t, cp_flush_info > cps;
+    uint64_t num_dependencies{0};     // Number of leader to follower links seen on the written buffers
+    uint64_t num_order_violations{0}; // Number of buffers written before all their leaders are written
+
+    void on_write(const IndexCPContext& cp_ctx, IndexBuffer* const* pbufs, size_t nbufs) {
+        std::unique_lock lg(mtx);
+        auto& info = cps[cp_ctx.id()];
+        info.num_flush_bufs = cp_ctx.num_flush_bufs();
+        for (size_t i{0}; i < nbufs; ++i) {
+            auto const buf = pbufs[i];
+            ++info.writes[buf];
+            info.partitions.insert(cp_ctx.partition_of(*buf));
+            if (!buf->m_wait_for_leaders.testz()) { ++num_order_violations; }
+
+            // Followers are released only after this write, so none of them could have been written already
+            for (const auto& next : buf->m_next_buffers) {
+                auto const next_buf = next.lock();
+                if (next_buf == nullptr) { continue; }
+                ++num_dependencies;
+                if (info.writes.count(next_buf.get())) { ++num_order_violations; }
+            }
+        }
+    }
+};
+#endif
+
 template < typename TestType >
 struct BtreeTest : public testing::Test {
     using T = TestType;
@@ -95,6 +148,7 @@ struct BtreeTest : public testing::Test {
             LOGINFO("Index table recovered");
             LOGINFO("Root bnode_id {} version {}", sb->root_node, sb->link_version);
             m_test->m_bt = std::make_shared< typename T::BtreeType >(sb, *m_test->m_bt_cfg);
+            m_test->m_bt->set_pin_interior_nodes(m_test->m_pin_interior_nodes);
             return m_test->m_bt;
         }
 
@@ -105,6 +159,7 @@ struct BtreeTest : public testing::Test {
     std::shared_ptr< typename T::BtreeType > m_bt;
     std::map< K, V > m_shadow_map;
     std::unique_ptr< BtreeConfig > m_bt_cfg;
+    bool m_pin_interior_nodes{false};
 
     void SetUp() override {
         test_common::HSTestHelper::start_homestore(
@@ -162,7 +217,7 @@ struct BtreeTest : public testing::Test {
         ASSERT_EQ(done, expected_done) << "Expected put of key " << k << " of put_type " << enum_name(put_type)
                                        << " to be " << expected_done;
         if (expected_done) {
-            m_shadow_map.insert(std::make_pair((const K&)*sreq.m_k, (const V&)*sreq.m_v));
+            m_shadow_map.insert_or_assign((const K&)*sreq.m_k, (const V&)*sreq.m_v);
         } else {
             const auto r = m_shadow_map.find(*sreq.m_k);
             ASSERT_NE(r, m_shadow_map.end()) << "Testcase issue, expected inserted slots to be in shadow map";
@@ -299,6 +354,16 @@ struct BtreeTest : public testing::Test {
         }
     }
 
+    // Bulk load the keys into the empty btree, streaming them out of the sorted shadow map
+    void bulk_load(uint32_t start_k, uint32_t end_k, uint32_t step) {
+        ASSERT_EQ(m_shadow_map.empty(), true) << "Testcase issue, bulk load is expected on an empty btree";
+        for (auto k{start_k}; k < end_k; k += step) {
+            m_shadow_map.emplace(K{k}, V::generate_rand());
+        }
+        ASSERT_EQ(m_bt->bulk_load(m_shadow_map.cbegin(), m_shadow_map.cend()), btree_status_t::success)
+            << "Bulk load failed";
+    }
+
     void print(const std::string& file = "") const { m_bt->print_tree(file); }
 
     void destroy_btree() {
@@ -309,6 +374,160 @@ struct BtreeTest : public testing::Test {
         m_bt.reset();
     }
 
+    // Nodes on the route to the key, from root to the leaf
+    std::vector< trace_route_entry > route_of(uint32_t k) const {
+        auto pk = std::make_unique< K >(k);
+        auto out_v = std::make_unique< V >();
+        auto req = BtreeSingleGetRequest{pk.get(), out_v.get()};
+        req.enable_route_tracing();
+        const auto ret = m_bt->get(req);
+        EXPECT_EQ(ret, btree_status_t::success) << "Missing key " << k << " in btree";
+        return *req.route_tracing;
+    }
+
+    bnodeid_t leaf_of(uint32_t k) const { return route_of(k).back().node_id; }
+
+    // Ids of all the interior and leaf nodes of the btree
+    std::pair< std::set< bnodeid_t >, std::set< bnodeid_t > > all_nodes(uint32_t num_entries) const {
+        std::set< bnodeid_t > interior_ids, leaf_ids;
+        for (uint32_t k{0}; k < num_entries; ++k) {
+            for (const auto& r : route_of(k)) {
+                (r.is_leaf ? leaf_ids : interior_ids).insert(r.node_id);
+            }
+        }
+        return {std::move(interior_ids), std::move(leaf_ids)};
+    }
+
+    IndexWBCache& wb() const { return s_cast< IndexWBCache& >(wb_cache()); }
+
+    // Node from the wb cache, read from the device if it is not cached
+    BtreeNodePtr cached_node(bnodeid_t id) const {
+        BtreeNodePtr node;
+        wb().read_buf(id, node, [this](const IndexBufferPtr& buf) { return node_from_buf(buf); });
+        return node;
+    }
+
+    BtreeNodePtr node_from_buf(const IndexBufferPtr& buf) const {
+        return IndexTableAccess< typename T::BtreeType >::make_node(*m_bt, buf);
+    }
+
+    // Run the job on the given number of io fibers of a worker reactor, which all interleave on the same thread,
+    // and wait for all of them to complete.
+    void run_on_io_fibers(uint32_t nfibers, const std::function< void(uint32_t) >& job) const {
+        std::vector< iomgr::io_fiber_t > fibers;
+        iomanager.run_on_wait(iomgr::reactor_regex::random_worker,
+                              [&fibers]() { fibers = iomanager.sync_io_capable_fibers(); });
+        ASSERT_GE(fibers.size(), nfibers) << "Not enough io fibers in the worker reactor";
+
+        std::mutex mtx;
+        std::condition_variable cv;
+        uint32_t pending{nfibers};
+        for (uint32_t i{0}; i < nfibers; ++i) {
+            iomanager.run_on_forget(fibers[i], [&job, &mtx, &cv, &pending, i]() {
+                job(i);
+                std::unique_lock lg(mtx);
+                if (--pending == 0) { cv.notify_one(); }
+            });
+        }
+        std::unique_lock lg(mtx);
+        cv.wait(lg, [&pending] { return (pending == 0); });
+    }
+
+#ifdef _PRERELEASE
+    // Insert the entries while taking cp flushes in between, tracking the buffers written by them
+    void flush_order_validate(uint32_t num_entries, uint32_t min_partitions = 1) {
+        FlushTracker tracker;
+        wb().set_flush_observer([&tracker](const IndexCPContext& cp_ctx, IndexBuffer* const* pbufs, size_t nbufs) {
+            tracker.on_write(cp_ctx, pbufs, nbufs);
+        });
+
+        LOGINFO("Do forward sequential insert for {} entries with cp flush every 500 entries", num_entries);
+        for (uint32_t i{0}; i < num_entries; ++i) {
+            put(i, btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+            if (i % 500 == 0) { test_common::HSTestHelper::trigger_cp(false /* wait */); }
+        }
+        test_common::HSTestHelper::trigger_cp(true /* wait */);
+        wb().set_flush_observer(nullptr);
+
+        LOGINFO("Validate {} cp flushes wrote every dirty buffer once and only after its leaders",
+                tracker.cps.size());
+        ASSERT_GT(tracker.num_dependencies, 0u) << "Testcase issue, expected splits to chain the buffers";
+        ASSERT_EQ(tracker.num_order_violations, 0u) << "Buffers are written before their leaders";
+        size_t max_partitions{0};
+        for (const auto& [cp_id, info] : tracker.cps) {
+            max_partitions = std::max(max_partitions, info.partitions.size());
+            ASSERT_EQ(info.writes.size(), info.num_flush_bufs) << "Not all dirty buffers are written in cp " << cp_id;
+            for (const auto& [buf, count] : info.writes) {
+                ASSERT_EQ(count, 1u) << "Buffer " << buf->to_string() << " is written more than once in cp " << cp_id;
+            }
+        }
+        ASSERT_GE(max_partitions, min_partitions) << "Testcase issue, expected the buffers to span more partitions";
+    }
+
+    // Blkids written by each io of cp flush, when the buffers of the given keys' leaves are updated and flushed
+    std::vector< std::vector< BlkId > > flush_ios_of_update(const std::vector< uint32_t >& keys) {
+        std::mutex mtx;
+        std::vector< std::vector< BlkId > > ios;
+        wb().set_flush_observer([&mtx, &ios](const IndexCPContext&, IndexBuffer* const* pbufs, size_t nbufs) {
+            std::vector< BlkId > io;
+            for (size_t i{0}; i < nbufs; ++i) {
+                io.push_back(pbufs[i]->m_blkid);
+            }
+            std::unique_lock lg(mtx);
+            ios.emplace_back(std::move(io));
+        });
+
+        for (auto const k : keys) {
+            put(k, btree_put_type::REPLACE_ONLY_IF_EXISTS);
+        }
+        test_common::HSTestHelper::trigger_cp(true /* wait */);
+        wb().set_flush_observer(nullptr);
+
+        // Every io should write the buffers of contiguous blks, within the configured max io size
+        auto const max_bufs_per_io =
+            std::max(HS_DYNAMIC_CONFIG(generic.cache_flush_max_io_size) / hs()->index_service().node_size(), 1u);
+        for (const auto& io : ios) {
+            EXPECT_LE(io.size(), max_bufs_per_io) << "Flush io is larger than cache_flush_max_io_size";
+            for (size_t i{1}; i < io.size(); ++i) {
+                EXPECT_EQ(io[i].chunk_num(), io[0].chunk_num()) << "Flush io spans more than one chunk";
+                EXPECT_EQ(io[i].blk_num(), io[i - 1].blk_num() + 1) << "Flush io coalesced non-adjacent blks";
+            }
+        }
+        return ios;
+    }
+#endif
+
+    void set_cache_flush_max_io_size(uint32_t size) {
+        HS_SETTINGS_FACTORY().modifiable_settings([size](auto& s) {
+            s.generic.cache_flush_max_io_size = size;
+            HS_SETTINGS_FACTORY().save();
+        });
+    }
+
+    void set_cache_flush_threads(int32_t nthreads) {
+        HS_SETTINGS_FACTORY().modifiable_settings([nthreads](auto& s) {
+            s.generic.cache_flush_threads = nthreads;
+            HS_SETTINGS_FACTORY().save();
+        });
+    }
+
+    void add_read_delay() {
+#ifdef _PRERELEASE
+        flip::FlipClient* fc = iomgr_flip::client_instance();
+
+        flip::FlipFrequency freq;
+        freq.set_count(1);
+        freq.set_percent(100);
+
+        // Delay the next read op by 100ms
+        fc->inject_delay_flip("simulate_drive_delay",
+                              {fc->create_condition("devname", flip::Operator::DONT_CARE, std::string("")),
+                               fc->create_condition("op_type", flip::Operator::EQUAL, std::string("READ")),
+                               fc->create_condition("reactor_id", flip::Operator::DONT_CARE, 0)},
+                              freq, 100000);
+#endif
+    }
+
     void compare_files(const std::string& before, const std::string& after) {
         std::ifstream b(before);
         std::ifstream a(after);
@@ -524,6 +743,49 @@ TYPED_TEST(BtreeTest, CpFlush) {
     LOGINFO("CpFlush test end");
 }
 
+TYPED_TEST(BtreeTest, BulkLoadCpFlush) {
+    LOGINFO("BulkLoadCpFlush test start");
+
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+#ifdef _PRERELEASE
+    FlushTracker tracker;
+    this->wb().set_flush_observer([&tracker](const IndexCPContext& cp_ctx, IndexBuffer* const* pbufs, size_t nbufs) {
+        tracker.on_write(cp_ctx, pbufs, nbufs);
+    });
+#endif
+    LOGINFO("Bulk load every other key of {} entries into the empty btree", num_entries);
+    this->bulk_load(0, num_entries, 2);
+    this->get_all_validate();
+    this->query_validate(0, num_entries - 1, 75);
+
+    LOGINFO("Trigger checkpoint flush.");
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+#ifdef _PRERELEASE
+    this->wb().set_flush_observer(nullptr);
+    ASSERT_GT(tracker.num_dependencies, 0u) << "Bulk load is expected to chain the children ahead of their parents";
+    ASSERT_EQ(tracker.num_order_violations, 0u) << "Parents are written before their children";
+#endif
+
+    this->print(std::string("before.txt"));
+    this->destroy_btree();
+
+    // Restart homestore. m_bt is updated by the TestIndexServiceCallback.
+    this->restart_homestore();
+    LOGINFO("Restarted homestore with index recovered");
+    this->print(std::string("after.txt"));
+    this->compare_files("before.txt", "after.txt");
+
+    LOGINFO("Validate the recovered btree and insert the remaining keys on top of it");
+    this->get_all_validate();
+    this->query_validate(0, num_entries - 1, 1000);
+    for (uint32_t k{1}; k < num_entries; k += 2) {
+        this->put(k, btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+    }
+    this->get_all_validate();
+    this->query_validate(0, num_entries - 1, 1000);
+    LOGINFO("BulkLoadCpFlush test end");
+}
+
 TYPED_TEST(BtreeTest, MultipleCpFlush) {
     LOGINFO("MultipleCpFlush test start");
 
@@ -618,6 +880,369 @@ TYPED_TEST(BtreeTest, ThreadedCpFlush) {
     LOGINFO("ThreadedCpFlush test end");
 }
 
+#ifdef _PRERELEASE
+TYPED_TEST(BtreeTest, CpFlushOrder) {
+    LOGINFO("CpFlushOrder test start");
+
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    this->flush_order_validate(num_entries);
+    LOGINFO("Query {} entries and validate with pagination of 75 entries", num_entries);
+    this->query_validate(0, num_entries - 1, 75);
+
+    this->print(std::string("before.txt"));
+    this->destroy_btree();
+
+    // Restart homestore. m_bt is updated by the TestIndexServiceCallback.
+    this->restart_homestore();
+    LOGINFO("Restarted homestore with index recovered");
+    this->print(std::string("after.txt"));
+
+    this->compare_files("before.txt", "after.txt");
+    LOGINFO("Query {} entries and validate with pagination of 1000 entries", num_entries);
+    this->query_validate(0, num_entries - 1, 1000);
+    LOGINFO("CpFlushOrder test end");
+}
+
+TYPED_TEST(BtreeTest, PartitionedCpFlushOrder) {
+    LOGINFO("PartitionedCpFlushOrder test start");
+
+    // Flush fibers are started along with the wb cache, so restart homestore to flush with more than one of them
+    static constexpr int32_t nflush_threads{2};
+    auto const prev_flush_threads = HS_DYNAMIC_CONFIG(generic.cache_flush_threads);
+    this->set_cache_flush_threads(nflush_threads);
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+    this->destroy_btree();
+    this->restart_homestore();
+    LOGINFO("Restarted homestore with {} cp flush threads", nflush_threads);
+
+    // Leaves are about half full on sequential inserts, so this many entries make the nodes span more than one stripe
+    // of blks of the flush partitions
+    auto const kv_size = TestFixture::K::get_fixed_size() + TestFixture::V::get_fixed_size();
+    auto const entries_per_leaf = hs()->index_service().node_size() / std::max(kv_size, 1u);
+    auto const num_entries = std::max(SISL_OPTIONS["num_entries"].as< uint32_t >(),
+                                      IndexCPContext::flush_partition_stripe_blks * entries_per_leaf);
+    this->flush_order_validate(num_entries, nflush_threads);
+    this->set_cache_flush_threads(prev_flush_threads);
+
+    LOGINFO("Query {} entries and validate with pagination of 1000 entries", num_entries);
+    this->query_validate(0, num_entries - 1, 1000);
+    LOGINFO("PartitionedCpFlushOrder test end");
+}
+
+TYPED_TEST(BtreeTest, CoalescedCpFlushWrites) {
+    LOGINFO("CoalescedCpFlushWrites test start");
+
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do forward sequential insert for {} entries and flush them", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+    }
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+
+    // Pick a key in every leaf, ordered by the location of the leaf on the device
+    std::map< std::pair< chunk_num_t, blk_num_t >, uint32_t > leaf_keys;
+    for (uint32_t k{0}; k < num_entries; ++k) {
+        auto const blkid = BlkId{this->leaf_of(k)};
+        leaf_keys.emplace(std::make_pair(blkid.chunk_num(), blkid.blk_num()), k);
+    }
+
+    // Leaves on a run of adjacent blks and leaves which are not adjacent to each other
+    static constexpr size_t run_len{4};
+    std::vector< uint32_t > adjacent_keys;
+    std::vector< uint32_t > non_adjacent_keys;
+    std::optional< std::pair< chunk_num_t, blk_num_t > > prev_loc, prev_picked_loc;
+    for (const auto& [loc, k] : leaf_keys) {
+        bool const adjacent_to_prev =
+            prev_loc && (prev_loc->first == loc.first) && (prev_loc->second + 1 == loc.second);
+        if (adjacent_keys.size() < run_len) {
+            if (!adjacent_to_prev) { adjacent_keys.clear(); }
+            adjacent_keys.push_back(k);
+        }
+        if (!prev_picked_loc || (prev_picked_loc->first != loc.first) || (prev_picked_loc->second + 1 < loc.second)) {
+            non_adjacent_keys.push_back(k);
+            prev_picked_loc = loc;
+        }
+        prev_loc = loc;
+    }
+    ASSERT_EQ(adjacent_keys.size(), run_len) << "Testcase issue, expected leaves to be on adjacent blks";
+    ASSERT_GT(non_adjacent_keys.size(), 1u) << "Testcase issue, expected leaves to be on non-adjacent blks";
+
+    LOGINFO("Step 2: Update {} leaves on adjacent blks and validate they are written in one io", run_len);
+    auto ios = this->flush_ios_of_update(adjacent_keys);
+    ASSERT_EQ(ios.size(), 1u) << "Buffers of adjacent blks are not coalesced into one io";
+    ASSERT_EQ(ios[0].size(), run_len);
+
+    LOGINFO("Step 3: Update {} leaves on non-adjacent blks and validate they are written in separate ios",
+            non_adjacent_keys.size());
+    ios = this->flush_ios_of_update(non_adjacent_keys);
+    ASSERT_EQ(ios.size(), non_adjacent_keys.size()) << "Buffers of non-adjacent blks are coalesced";
+
+    LOGINFO("Step 4: Limit the io size to 2 nodes, update {} leaves on adjacent blks and validate the ios are split",
+            run_len);
+    auto const prev_max_io_size = HS_DYNAMIC_CONFIG(generic.cache_flush_max_io_size);
+    this->set_cache_flush_max_io_size(2 * hs()->index_service().node_size());
+    ios = this->flush_ios_of_update(adjacent_keys);
+    ASSERT_EQ(ios.size(), run_len / 2) << "Coalesced writes are not split by cache_flush_max_io_size";
+
+    LOGINFO("Step 5: Disable the coalescing, update {} leaves on adjacent blks and validate they are not coalesced",
+            run_len);
+    this->set_cache_flush_max_io_size(hs()->index_service().node_size() - 1);
+    ios = this->flush_ios_of_update(adjacent_keys);
+    ASSERT_EQ(ios.size(), run_len) << "Buffers are coalesced below cache_flush_max_io_size of a node";
+    this->set_cache_flush_max_io_size(prev_max_io_size);
+
+    LOGINFO("Query {} entries and validate with pagination of 75 entries", num_entries);
+    this->query_validate(0, num_entries - 1, 75);
+    LOGINFO("CoalescedCpFlushWrites test end");
+}
+
+TYPED_TEST(BtreeTest, InteriorNodeEvictSkips) {
+    LOGINFO("InteriorNodeEvictSkips test start");
+
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do forward sequential insert for {} entries and flush them", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+    }
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+
+    auto const route = this->route_of(num_entries / 2);
+    ASSERT_GT(route.size(), 1u) << "Testcase issue, expected the btree to have interior nodes";
+    auto const interior_id = route.front().node_id;
+    auto const leaf_id = route.back().node_id;
+    auto const evict_skips = HS_DYNAMIC_CONFIG(cache.btree_interior_node_evict_skips);
+
+    // Access of a node from cache resets its skips, after that only the cache holds a reference to it
+    LOGINFO("Step 2: Validate interior node is skipped {} times by the evictor after its access", evict_skips);
+    BtreeNode* interior = this->cached_node(interior_id).get();
+    for (uint32_t i{0}; i < evict_skips; ++i) {
+        ASSERT_EQ(IndexWBCache::is_evictable(interior), false) << "Interior node is evicted without skips";
+    }
+    ASSERT_EQ(IndexWBCache::is_evictable(interior), true) << "Interior node is not evicted after its skips";
+
+    LOGINFO("Step 3: Validate access of interior node gives it the skips again");
+    interior = this->cached_node(interior_id).get();
+    ASSERT_EQ(IndexWBCache::is_evictable(interior), (evict_skips == 0)) << "Access didn't reset the skips";
+
+    LOGINFO("Step 4: Validate leaf node is evicted in LRU order, unless it is referenced outside of the cache");
+    auto leaf = this->cached_node(leaf_id);
+    ASSERT_EQ(IndexWBCache::is_evictable(leaf.get()), false) << "Node referenced outside of cache is evicted";
+    BtreeNode* const pleaf = leaf.get();
+    leaf.reset();
+    ASSERT_EQ(IndexWBCache::is_evictable(pleaf), true) << "Leaf node is skipped by the evictor";
+
+    LOGINFO("Query {} entries and validate with pagination of 75 entries", num_entries);
+    this->query_validate(0, num_entries - 1, 75);
+    LOGINFO("InteriorNodeEvictSkips test end");
+}
+
+TYPED_TEST(BtreeTest, PinnedInteriorNodes) {
+    LOGINFO("PinnedInteriorNodes test start");
+    this->m_pin_interior_nodes = true;
+    this->m_bt->set_pin_interior_nodes(true);
+
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do forward sequential insert for {} entries and flush them", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+    }
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+
+    // Pinned nodes are kept outside of the cache evictor, so they stay in memory regardless of the cache pressure
+    LOGINFO("Step 2: Validate all the interior nodes and none of the leaf nodes are pinned");
+    auto const [interior_ids, leaf_ids] = this->all_nodes(num_entries);
+    ASSERT_GT(interior_ids.size(), 0u) << "Testcase issue, expected the btree to have interior nodes";
+    for (auto const id : interior_ids) {
+        ASSERT_EQ(this->wb().is_node_pinned(id), true) << "Interior node " << id << " is not pinned";
+    }
+    for (auto const id : leaf_ids) {
+        ASSERT_EQ(this->wb().is_node_pinned(id), false) << "Leaf node " << id << " is pinned";
+    }
+    ASSERT_EQ(this->wb().num_pinned_nodes(), interior_ids.size()) << "Nodes other than the interior nodes are pinned";
+
+    LOGINFO("Step 3: Destroy the btree and validate the freed interior nodes are not pinned anymore");
+    this->destroy_btree();
+    ASSERT_EQ(this->wb().num_pinned_nodes(), 0u) << "Freed nodes are left in the pinned nodes";
+
+    // Restart homestore. m_bt is updated by the TestIndexServiceCallback, with the interior nodes pinned.
+    this->restart_homestore();
+    LOGINFO("Restarted homestore with index recovered");
+
+    LOGINFO("Step 4: Query {} entries and validate the interior nodes read from device are pinned", num_entries);
+    this->query_validate(0, num_entries - 1, 1000);
+    auto const [recovered_interior_ids, recovered_leaf_ids] = this->all_nodes(num_entries);
+    ASSERT_EQ(recovered_interior_ids, interior_ids) << "Recovered btree has different interior nodes";
+    for (auto const id : interior_ids) {
+        ASSERT_EQ(this->wb().is_node_pinned(id), true) << "Interior node " << id << " read from device is not pinned";
+    }
+    ASSERT_EQ(this->wb().num_pinned_nodes(), interior_ids.size()) << "Nodes other than the interior nodes are pinned";
+    LOGINFO("PinnedInteriorNodes test end");
+}
+
+TYPED_TEST(BtreeTest, SweepQueryPrefetch) {
+    LOGINFO("SweepQueryPrefetch test start");
+    this->m_bt_cfg->m_max_query_prefetch_nodes = 8;
+
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do forward sequential insert for {} entries and flush them", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+    }
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+
+    // Leaves in the order of their keys, along with the number of keys in each of them
+    std::vector< std::pair< bnodeid_t, uint32_t > > leaves;
+    for (uint32_t k{0}; k < num_entries; ++k) {
+        auto const id = this->leaf_of(k);
+        if (leaves.empty() || (leaves.back().first != id)) { leaves.emplace_back(id, 0u); }
+        ++leaves.back().second;
+    }
+    ASSERT_GT(leaves.size(), 4u) << "Testcase issue, expected more leaves in the btree";
+
+    // Restart homestore, so that the leaves are not in the cache. m_bt is updated by the TestIndexServiceCallback.
+    this->destroy_btree();
+    this->restart_homestore();
+    LOGINFO("Restarted homestore with index recovered");
+    for (size_t i{0}; i < 4; ++i) {
+        ASSERT_EQ(this->wb().is_node_cached(leaves[i].first), false) << "Leaf is in cache after restart";
+    }
+
+    // Batch ends at the end of the third leaf, while the sweep reads ahead of it on the way
+    auto const batch_size = leaves[0].second + leaves[1].second + leaves[2].second;
+    LOGINFO("Step 2: Query the first {} entries from an io fiber and validate the results", batch_size);
+    BtreeQueryRequest< typename TestFixture::K > qreq{
+        BtreeKeyRange< typename TestFixture::K >{typename TestFixture::K{0u}, true,
+                                                 typename TestFixture::K{num_entries - 1}, true},
+        BtreeQueryType::SWEEP_NON_INTRUSIVE_PAGINATION_QUERY, batch_size};
+    qreq.enable_route_tracing();
+    this->run_on_io_fibers(1, [this, &qreq, batch_size](uint32_t) {
+        std::vector< std::pair< typename TestFixture::K, typename TestFixture::V > > out_vector;
+        ASSERT_EQ(this->m_bt->query(qreq, out_vector), btree_status_t::has_more);
+        ASSERT_EQ(out_vector.size(), batch_size) << "Received incorrect number of entries on query";
+        auto it = this->m_shadow_map.cbegin();
+        for (const auto& [k, v] : out_vector) {
+            ASSERT_EQ(k, it->first) << "Query returned incorrect key";
+            ASSERT_EQ(v, it->second) << "Query doesn't return correct data for key=" << k;
+            ++it;
+        }
+    });
+
+    std::set< bnodeid_t > queried_leaves;
+    for (const auto& r : *qreq.route_tracing) {
+        if (r.is_leaf) { queried_leaves.insert(r.node_id); }
+    }
+    ASSERT_EQ(queried_leaves, (std::set< bnodeid_t >{leaves[0].first, leaves[1].first, leaves[2].first}))
+        << "Query read leaves other than the ones holding its batch";
+
+    LOGINFO("Step 3: Validate the leaf after the batch, which the query didn't read, is prefetched into cache");
+    bool prefetched{false};
+    for (uint32_t i{0}; (i < 500) && !prefetched; ++i) {
+        prefetched = this->wb().is_node_cached(leaves[3].first);
+        if (!prefetched) { std::this_thread::sleep_for(std::chrono::milliseconds{10}); }
+    }
+    ASSERT_EQ(prefetched, true) << "Leaf after the batch of the query is not prefetched";
+
+    this->destroy_btree();
+    this->restart_homestore();
+    LOGINFO("Restarted homestore with index recovered");
+
+    // Range ends at the last key of the second leaf, so the sweep has no reason to read ahead of the second leaf
+    auto const end_k = leaves[0].second + leaves[1].second - 1;
+    LOGINFO("Step 4: Query the range [0, {}] and validate the leaf after the range is not prefetched", end_k);
+    this->run_on_io_fibers(1, [this, end_k](uint32_t) { this->query_validate(0, end_k, UINT32_MAX); });
+    std::this_thread::sleep_for(std::chrono::milliseconds{100});
+    ASSERT_EQ(this->wb().is_node_cached(leaves[2].first), false) << "Leaf after the end of the query is prefetched";
+
+    LOGINFO("Query {} entries and validate with pagination of 1000 entries", num_entries);
+    this->query_validate(0, num_entries - 1, 1000);
+    LOGINFO("SweepQueryPrefetch test end");
+}
+#endif
+
+TYPED_TEST(BtreeTest, CoalescedNodeRead) {
+    LOGINFO("CoalescedNodeRead test start");
+
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do forward sequential insert for {} entries and flush them", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+    }
+    auto const leaf_id = this->leaf_of(num_entries / 2);
+    auto const other_leaf_id = this->leaf_of(0);
+    ASSERT_NE(leaf_id, other_leaf_id) << "Testcase issue, expected the keys to be in different leaves";
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+
+    // Restart homestore, so that none of the nodes are in the cache and the reads have to go to the device
+    this->destroy_btree();
+    this->restart_homestore();
+    LOGINFO("Restarted homestore with index recovered");
+
+    static constexpr uint32_t nfibers{4};
+    std::atomic< uint32_t > num_device_reads{0};
+    auto counting_initializer = [this, &num_device_reads](const IndexBufferPtr& buf) {
+        num_device_reads.fetch_add(1);
+        return this->node_from_buf(buf);
+    };
+
+    LOGINFO("Step 2: Read the same leaf from {} fibers at once and validate that only one read goes to the device",
+            nfibers);
+    std::array< BtreeNodePtr, nfibers > nodes;
+    uint32_t arrived{0};
+    this->add_read_delay();
+    this->run_on_io_fibers(nfibers, [this, &nodes, &arrived, &counting_initializer, leaf_id](uint32_t i) {
+        // All the fibers run on the same thread, make all of them miss the cache before the first read completes
+        ++arrived;
+        while (arrived < nfibers) {
+            boost::this_fiber::yield();
+        }
+        this->wb().read_buf(leaf_id, nodes[i], counting_initializer);
+    });
+    ASSERT_EQ(num_device_reads.load(), 1u) << "Concurrent reads of the same node are not coalesced";
+    for (const auto& node : nodes) {
+        ASSERT_NE(node, nullptr) << "Waiter of the coalesced read didn't get the node";
+        ASSERT_EQ(node.get(), nodes[0].get()) << "Waiters of the coalesced read got different nodes";
+        ASSERT_EQ(node->node_id(), leaf_id);
+    }
+    nodes.fill(nullptr);
+
+    LOGINFO("Step 3: Fail the read of another leaf read from {} fibers at once and validate all of them fail",
+            nfibers);
+    num_device_reads.store(0);
+    arrived = 0;
+    std::atomic< uint32_t > num_failed{0};
+    auto failing_initializer = [&num_device_reads](const IndexBufferPtr& buf) -> BtreeNodePtr {
+        num_device_reads.fetch_add(1);
+        throw std::runtime_error(fmt::format("Simulated failure of read of blkid={}", buf->blkid().to_string()));
+    };
+    this->add_read_delay();
+    this->run_on_io_fibers(nfibers, [this, &nodes, &arrived, &num_failed, &failing_initializer,
+                                     other_leaf_id](uint32_t i) {
+        ++arrived;
+        while (arrived < nfibers) {
+            boost::this_fiber::yield();
+        }
+        try {
+            this->wb().read_buf(other_leaf_id, nodes[i], failing_initializer);
+        } catch (const std::exception&) { num_failed.fetch_add(1); }
+    });
+    ASSERT_EQ(num_device_reads.load(), 1u) << "Concurrent reads of the same node are not coalesced";
+    ASSERT_EQ(num_failed.load(), nfibers) << "Failure of the coalesced read is not propagated to all its waiters";
+
+    LOGINFO("Step 4: Read the failed leaf again and validate it is read from the device");
+    num_device_reads.store(0);
+    this->run_on_io_fibers(1, [this, &nodes, &counting_initializer, other_leaf_id](uint32_t i) {
+        this->wb().read_buf(other_leaf_id, nodes[i], counting_initializer);
+    });
+    ASSERT_EQ(num_device_reads.load(), 1u) << "Failed read is not retried on the next read";
+    ASSERT_NE(nodes[0], nullptr);
+    ASSERT_EQ(nodes[0]->node_id(), other_leaf_id);
+    nodes.fill(nullptr);
+
+    LOGINFO("Query {} entries and validate with pagination of 1000 entries", num_entries);
+    this->query_validate(0, num_entries - 1, 1000);
+    LOGINFO("CoalescedNodeRead test end");
+}
+
 int main(int argc, char* argv[]) {
     int parsed_argc{argc};
     ::testing::InitGoogleTest(&parsed_argc, argv);
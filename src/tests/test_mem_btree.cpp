@@ -13,8 +13,10 @@
  * specific language governing permissions and limitations under the License.
  *
  *********************************************************************************/
+#include <algorithm>
 #include <random>
 #include <map>
+#include <set>
 #include <memory>
 #include <gtest/gtest.h>
 #include <iomgr/io_environment.hpp>
@@ -22,9 +24,12 @@
 #include <sisl/logging/logging.h>
 #include <sisl/utility/enum.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/fiber/all.hpp>
 #include "btree_test_kvs.hpp"
 #include <homestore/btree/detail/simple_node.hpp>
 #include <homestore/btree/detail/varlen_node.hpp>
+#include <homestore/btree/detail/prefix_node.hpp>
+#include <homestore/btree/detail/compact_node.hpp>
 #include <homestore/btree/mem_btree.hpp>
 #include "test_common/range_scheduler.hpp"
 
@@ -81,6 +86,22 @@ struct VarObjSizeBtreeTest {
     static constexpr btree_node_type interior_node_type = btree_node_type::VAR_OBJECT;
 };
 
+struct PrefixBtreeTest {
+    using BtreeType = MemBtree< TestVarLenKey, TestVarLenValue >;
+    using KeyType = TestVarLenKey;
+    using ValueType = TestVarLenValue;
+    static constexpr btree_node_type leaf_node_type = btree_node_type::PREFIX;
+    static constexpr btree_node_type interior_node_type = btree_node_type::PREFIX;
+};
+
+struct CompactBtreeTest {
+    using BtreeType = MemBtree< TestFixedKey, TestFixedValue >;
+    using KeyType = TestFixedKey;
+    using ValueType = TestFixedValue;
+    static constexpr btree_node_type leaf_node_type = btree_node_type::COMPACT;
+    static constexpr btree_node_type interior_node_type = btree_node_type::COMPACT;
+};
+
 template < typename TestType >
 struct BtreeTest : public testing::Test {
     using T = TestType;
@@ -99,6 +120,26 @@ struct BtreeTest : public testing::Test {
         m_bt->init(nullptr);
     }
 
+    // Value of the btree metric with the given description. Histograms are reported as "avg / p50 / p95 / p99", of
+    // which the average is returned.
+    double metric_value(const std::string& desc) const {
+        const auto metrics = m_bt->get_metrics_in_json();
+        for (const auto& [type, entries] : metrics.items()) {
+            if (!entries.is_object()) { continue; }
+            for (const auto& [name, value] : entries.items()) {
+                if (name.rfind(desc, 0) != 0) { continue; }
+                if (value.is_string()) { return std::stod(value.template get< std::string >()); }
+                return value.template get< double >();
+            }
+        }
+        ADD_FAILURE() << "Metric '" << desc << "' is missing in btree metrics " << metrics.dump();
+        return 0;
+    }
+
+    uint64_t num_nodes() const {
+        return s_cast< uint64_t >(metric_value("Btree Leaf node count") + metric_value("Btree Interior node count"));
+    }
+
     void put(uint32_t k, btree_put_type put_type) {
         auto existing_v = std::make_unique< V >();
         auto pk = std::make_unique< K >(k);
@@ -123,6 +164,50 @@ struct BtreeTest : public testing::Test {
         }
     }
 
+    void batch_put(const std::vector< uint32_t >& keys, btree_put_type put_type) {
+        std::vector< std::unique_ptr< K > > in_keys;
+        std::vector< std::unique_ptr< V > > in_vals;
+        std::vector< std::unique_ptr< V > > existing_vals;
+        auto breq = BtreeBatchPutRequest{put_type};
+        for (auto k : keys) {
+            in_keys.emplace_back(std::make_unique< K >(k));
+            in_vals.emplace_back(std::make_unique< V >(V::generate_rand()));
+            existing_vals.emplace_back(std::make_unique< V >());
+            breq.add(in_keys.back().get(), in_vals.back().get(), existing_vals.back().get());
+        }
+
+        bool all_done{true};
+        const auto ret = m_bt->put(breq);
+        for (uint32_t i{0}; i < breq.num_keys(); ++i) {
+            const auto& key = (const K&)breq.key(i);
+            bool expected_done{true};
+            if (m_shadow_map.find(key) != m_shadow_map.end()) {
+                expected_done = (put_type != btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+            }
+            ASSERT_EQ(breq.status(i) == btree_status_t::success, expected_done)
+                << "Expected batch put of key " << key << " of put_type " << enum_name(put_type) << " to be "
+                << expected_done;
+            if (expected_done) {
+                m_shadow_map.insert_or_assign(key, (const V&)breq.value(i));
+            } else {
+                all_done = false;
+            }
+        }
+        ASSERT_EQ(ret, all_done ? btree_status_t::success : btree_status_t::put_failed)
+            << "Batch put returned incorrect status";
+    }
+
+    void bulk_load(uint32_t start_k, uint32_t end_k, uint32_t step) {
+        std::vector< std::pair< K, V > > kvs;
+        for (auto k{start_k}; k < end_k; k += step) {
+            kvs.emplace_back(K{k}, V::generate_rand());
+        }
+        ASSERT_EQ(m_bt->bulk_load(kvs, nullptr), btree_status_t::success) << "Bulk load failed";
+        for (const auto& [k, v] : kvs) {
+            m_shadow_map.insert(std::make_pair(k, v));
+        }
+    }
+
     void range_put(uint32_t start_entry, uint32_t end_entry, bool expected) {
         auto val = std::make_unique< V >(V::generate_rand());
         auto mreq = BtreeRangePutRequest< K >{BtreeKeyRange< K >{start_entry, true, end_entry, true},
@@ -209,13 +294,13 @@ struct BtreeTest : public testing::Test {
         query_validate(0u, SISL_OPTIONS["num_entries"].as< uint32_t >() - 1, batch_size);
     }
 
-    void query_validate(uint32_t start_k, uint32_t end_k, uint32_t batch_size) const {
+    void query_validate(uint32_t start_k, uint32_t end_k, uint32_t batch_size,
+                        BtreeQueryType qtype = BtreeQueryType::SWEEP_NON_INTRUSIVE_PAGINATION_QUERY) const {
         std::vector< std::pair< K, V > > out_vector;
         uint32_t remaining = num_elems_in_range(start_k, end_k);
         auto it = m_shadow_map.lower_bound(K{start_k});
 
-        BtreeQueryRequest< K > qreq{BtreeKeyRange< K >{K{start_k}, true, K{end_k}, true},
-                                    BtreeQueryType::SWEEP_NON_INTRUSIVE_PAGINATION_QUERY, batch_size};
+        BtreeQueryRequest< K > qreq{BtreeKeyRange< K >{K{start_k}, true, K{end_k}, true}, qtype, batch_size};
         while (remaining > 0) {
             out_vector.clear();
             auto const ret = m_bt->query(qreq, out_vector);
@@ -242,6 +327,98 @@ struct BtreeTest : public testing::Test {
         ASSERT_EQ(out_vector.size(), 0) << "Received incorrect value on empty query pagination";
     }
 
+    void query_end_validate(uint32_t start_k, uint32_t end_k, bool end_incl, uint32_t batch_size) const {
+        std::vector< std::pair< K, V > > expected;
+        for (auto it = m_shadow_map.lower_bound(K{start_k}); it != m_shadow_map.end(); ++it) {
+            const auto cmp = it->first.compare(K{end_k});
+            if ((cmp > 0) || ((cmp == 0) && !end_incl)) { break; }
+            expected.push_back(*it);
+        }
+
+        std::vector< std::pair< K, V > > out_vector;
+        std::vector< std::pair< K, V > > all_out;
+        BtreeQueryRequest< K > qreq{BtreeKeyRange< K >{K{start_k}, true, K{end_k}, end_incl},
+                                    BtreeQueryType::SWEEP_NON_INTRUSIVE_PAGINATION_QUERY, batch_size};
+        btree_status_t ret;
+        do {
+            out_vector.clear();
+            ret = m_bt->query(qreq, out_vector);
+            ASSERT_LE(out_vector.size(), batch_size) << "Query returned more than the batch size";
+            all_out.insert(all_out.end(), out_vector.begin(), out_vector.end());
+        } while (ret == btree_status_t::has_more);
+        ASSERT_EQ(ret, btree_status_t::success) << "Expected success on query";
+
+        ASSERT_EQ(all_out.size(), expected.size())
+            << "Query of [" << start_k << ", " << end_k << (end_incl ? "]" : ")") << " returned incorrect count";
+        for (size_t idx{0}; idx < all_out.size(); ++idx) {
+            ASSERT_EQ(all_out[idx].first, expected[idx].first) << "Query returned incorrect key at idx=" << idx;
+            ASSERT_EQ(all_out[idx].second, expected[idx].second)
+                << "Query doesn't return correct data for key=" << expected[idx].first;
+        }
+    }
+
+    void reverse_query_validate(uint32_t start_k, uint32_t end_k, uint32_t batch_size) const {
+        std::vector< std::pair< K, V > > out_vector;
+        uint32_t remaining = num_elems_in_range(start_k, end_k);
+        auto it = std::make_reverse_iterator(m_shadow_map.upper_bound(K{end_k}));
+
+        BtreeQueryRequest< K > qreq{BtreeKeyRange< K >{K{start_k}, true, K{end_k}, true},
+                                    BtreeQueryType::SWEEP_NON_INTRUSIVE_PAGINATION_REVERSE_QUERY, batch_size};
+        while (remaining > 0) {
+            out_vector.clear();
+            auto const ret = m_bt->query(qreq, out_vector);
+            auto const expected_count = std::min(remaining, batch_size);
+
+            ASSERT_EQ(out_vector.size(), expected_count) << "Received incorrect value on reverse query pagination";
+            remaining -= expected_count;
+            ASSERT_EQ(ret, (remaining == 0) ? btree_status_t::success : btree_status_t::has_more);
+
+            for (size_t idx{0}; idx < out_vector.size(); ++idx) {
+                ASSERT_EQ(out_vector[idx].first, it->first) << "Reverse query returned keys out of order";
+                ASSERT_EQ(out_vector[idx].second, it->second)
+                    << "Reverse query doesn't return correct data for key=" << it->first << " idx=" << idx;
+                ++it;
+            }
+        }
+        out_vector.clear();
+        auto ret = m_bt->query(qreq, out_vector);
+        ASSERT_EQ(ret, btree_status_t::success) << "Expected success on reverse query";
+        ASSERT_EQ(out_vector.size(), 0) << "Received incorrect value on empty reverse query pagination";
+    }
+
+    void query_visit_validate(uint32_t start_k, uint32_t end_k, uint32_t batch_size) const {
+        std::vector< std::pair< K, V > > out_vector;
+        std::vector< uint8_t > arena;
+        uint32_t remaining = num_elems_in_range(start_k, end_k);
+        auto it = m_shadow_map.lower_bound(K{start_k});
+
+        BtreeQueryRequest< K > qreq{BtreeKeyRange< K >{K{start_k}, true, K{end_k}, true},
+                                    BtreeQueryType::SWEEP_NON_INTRUSIVE_PAGINATION_QUERY, batch_size};
+        auto const visitor = [&out_vector](const sisl::blob& kb, const sisl::blob& vb) {
+            K key;
+            key.deserialize(kb, true);
+            V value;
+            value.deserialize(vb, true);
+            out_vector.emplace_back(key, value);
+        };
+        while (remaining > 0) {
+            out_vector.clear();
+            auto const ret = m_bt->query(qreq, visitor, &arena);
+            auto const expected_count = std::min(remaining, batch_size);
+
+            ASSERT_EQ(out_vector.size(), expected_count) << "Received incorrect count on visitor query pagination";
+            remaining -= expected_count;
+            ASSERT_EQ(ret, (remaining == 0) ? btree_status_t::success : btree_status_t::has_more);
+
+            for (size_t idx{0}; idx < out_vector.size(); ++idx) {
+                ASSERT_EQ(out_vector[idx].first, it->first) << "Visitor query returned incorrect key";
+                ASSERT_EQ(out_vector[idx].second, it->second)
+                    << "Visitor query doesn't return correct data for key=" << it->first << " idx=" << idx;
+                ++it;
+            }
+        }
+    }
+
     void get_all_validate() const {
         for (const auto& [key, value] : m_shadow_map) {
             auto copy_key = std::make_unique< K >();
@@ -288,6 +465,32 @@ struct BtreeTest : public testing::Test {
         }
     }
 
+    void multi_get_validate(const std::vector< uint32_t >& keys) const {
+        std::vector< std::unique_ptr< K > > in_keys;
+        std::vector< std::unique_ptr< V > > out_vals;
+        BtreeMultiGetRequest req;
+        for (auto k : keys) {
+            in_keys.emplace_back(std::make_unique< K >(k));
+            out_vals.emplace_back(std::make_unique< V >());
+            req.add(in_keys.back().get(), out_vals.back().get());
+        }
+
+        bool all_found{true};
+        const auto ret = m_bt->get(req);
+        for (uint32_t i{0}; i < req.num_keys(); ++i) {
+            const auto& key = (const K&)req.key(i);
+            if (req.status(i) == btree_status_t::success) {
+                validate_data(key, (const V&)req.value(i));
+            } else {
+                all_found = false;
+                ASSERT_EQ((m_shadow_map.find(key) == m_shadow_map.end()), true)
+                    << "Multi get missed key " << key << " which is present in shadow map";
+            }
+        }
+        ASSERT_EQ(ret, all_found ? btree_status_t::success : btree_status_t::not_found)
+            << "Multi get returned incorrect status";
+    }
+
     void print() const { m_bt->print_tree(); }
 
     void print_keys() const { m_bt->print_tree_keys(); }
@@ -336,7 +539,8 @@ private:
     }
 };
 
-using BtreeTypes = testing::Types< FixedLenBtreeTest, VarKeySizeBtreeTest, VarValueSizeBtreeTest, VarObjSizeBtreeTest >;
+using BtreeTypes = testing::Types< FixedLenBtreeTest, VarKeySizeBtreeTest, VarValueSizeBtreeTest, VarObjSizeBtreeTest,
+                                   PrefixBtreeTest, CompactBtreeTest >;
 TYPED_TEST_SUITE(BtreeTest, BtreeTypes);
 
 TYPED_TEST(BtreeTest, SequentialInsert) {
@@ -421,6 +625,351 @@ TYPED_TEST(BtreeTest, RandomInsert) {
     this->get_all_validate();
 }
 
+TYPED_TEST(BtreeTest, MultiGet) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do forward sequential insert for every other key of {} entries", num_entries);
+    for (uint32_t i{0}; i < num_entries; i += 2) {
+        this->put(i, btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+    }
+
+    LOGINFO("Step 2: Multi get batches of random keys, half of which are absent and some repeated");
+    static thread_local std::uniform_int_distribution< uint32_t > s_rand_key_generator{0, num_entries - 1};
+    static thread_local std::uniform_int_distribution< uint32_t > s_rand_batch_size_generator{1, 64};
+    for (uint32_t i{0}; i < 100; ++i) {
+        std::vector< uint32_t > keys(s_rand_batch_size_generator(g_re));
+        for (auto& k : keys) {
+            k = s_rand_key_generator(g_re);
+        }
+        this->multi_get_validate(keys);
+    }
+
+    LOGINFO("Step 3: Multi get all present keys in reverse order in a single batch");
+    std::vector< uint32_t > keys;
+    for (uint32_t i{0}; i < num_entries; i += 2) {
+        keys.push_back(i);
+    }
+    std::reverse(keys.begin(), keys.end());
+    this->multi_get_validate(keys);
+}
+
+TYPED_TEST(BtreeTest, BatchPut) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    static thread_local std::uniform_int_distribution< uint32_t > s_rand_key_generator{0, num_entries - 1};
+    static thread_local std::uniform_int_distribution< uint32_t > s_rand_batch_size_generator{1, 128};
+
+    LOGINFO("Step 1: Do batch inserts of random sorted keys, some of which are already present");
+    uint32_t inserted{0};
+    while (inserted < num_entries / 2) {
+        std::set< uint32_t > keys;
+        for (auto n = s_rand_batch_size_generator(g_re); n > 0; --n) {
+            keys.insert(s_rand_key_generator(g_re));
+        }
+        this->batch_put(std::vector< uint32_t >(keys.begin(), keys.end()), btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+        inserted += keys.size();
+    }
+    this->get_all_validate();
+
+    LOGINFO("Step 2: Do one large batch upsert across the whole key space");
+    std::vector< uint32_t > keys;
+    for (uint32_t k{0}; k < num_entries; k += 3) {
+        keys.push_back(k);
+    }
+    this->batch_put(keys, btree_put_type::REPLACE_IF_EXISTS_ELSE_INSERT);
+    this->get_all_validate();
+    this->query_validate(0, num_entries - 1, 75);
+}
+
+TYPED_TEST(BtreeTest, BulkLoad) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Bulk load every other key of {} entries into empty btree", num_entries);
+    this->bulk_load(0, num_entries, 2);
+    this->get_all_validate();
+    this->query_validate(0, num_entries - 1, 75);
+
+    LOGINFO("Step 2: Insert the remaining keys in random order on top of the bulk loaded btree");
+    std::vector< uint32_t > vec;
+    for (uint32_t k{1}; k < num_entries; k += 2) {
+        vec.push_back(k);
+    }
+    std::random_shuffle(vec.begin(), vec.end());
+    for (auto k : vec) {
+        this->put(k, btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+    }
+    this->get_all_validate();
+
+    LOGINFO("Step 3: Remove half of the keys and validate");
+    for (uint32_t k{0}; k < num_entries; k += 2) {
+        this->remove_one(k);
+    }
+    this->query_validate(0, num_entries - 1, 75);
+}
+
+TYPED_TEST(BtreeTest, VisitorQuery) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    std::vector< uint32_t > vec(num_entries);
+    iota(vec.begin(), vec.end(), 0);
+    std::random_shuffle(vec.begin(), vec.end());
+    LOGINFO("Step 1: Do random insert for half of {} entries", num_entries);
+    for (uint32_t i{0}; i < num_entries; i += 2) {
+        this->put(vec[i], btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+    }
+
+    LOGINFO("Step 2: Query all entries through visitor with pagination and validate");
+    this->query_visit_validate(0, num_entries - 1, 75);
+
+    LOGINFO("Step 3: Query a sub range through visitor in one batch and validate");
+    this->query_visit_validate(num_entries / 4, num_entries / 2, UINT32_MAX);
+}
+
+TYPED_TEST(BtreeTest, LockedPaginationQuery) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    std::vector< uint32_t > vec(num_entries);
+    iota(vec.begin(), vec.end(), 0);
+    std::random_shuffle(vec.begin(), vec.end());
+    LOGINFO("Step 1: Do random insert for half of {} entries", num_entries);
+    for (uint32_t i{0}; i < num_entries; i += 2) {
+        this->put(vec[i], btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+    }
+
+    LOGINFO("Step 2: Intrusive sweep query with pagination and validate");
+    this->query_validate(0, num_entries - 1, 75, BtreeQueryType::SWEEP_INTRUSIVE_PAGINATION_QUERY);
+    this->query_validate(num_entries / 4, num_entries / 2, 10, BtreeQueryType::SWEEP_INTRUSIVE_PAGINATION_QUERY);
+
+    LOGINFO("Step 3: Serializable query with pagination and validate");
+    this->query_validate(0, num_entries - 1, 75, BtreeQueryType::SERIALIZABLE_QUERY);
+    this->query_validate(num_entries / 4, num_entries / 2, 10, BtreeQueryType::SERIALIZABLE_QUERY);
+
+    LOGINFO("Step 4: Abandon queries after first page and validate their locks are released");
+    using K = typename TestFixture::K;
+    using V = typename TestFixture::V;
+    for (auto qtype : {BtreeQueryType::SWEEP_INTRUSIVE_PAGINATION_QUERY, BtreeQueryType::SERIALIZABLE_QUERY}) {
+        std::vector< std::pair< K, V > > out_vector;
+        {
+            BtreeQueryRequest< K > qreq{BtreeKeyRange< K >{K{0}, true, K{num_entries - 1}, true}, qtype, 5};
+            ASSERT_EQ(this->m_bt->query(qreq, out_vector), btree_status_t::has_more);
+        }
+        for (uint32_t i{1}; i < num_entries; i += 2) {
+            this->put(vec[i], btree_put_type::REPLACE_IF_EXISTS_ELSE_INSERT);
+        }
+    }
+    this->query_all_validate();
+}
+
+TYPED_TEST(BtreeTest, SerializableQueryBlocksWriters) {
+    using K = typename TestFixture::K;
+    using V = typename TestFixture::V;
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+
+    LOGINFO("Step 1: Insert even keys of {} entries on a btree which lets a serializable query lock 2 leaves",
+            num_entries);
+    this->m_cfg.m_max_query_locked_nodes = 2;
+    this->m_bt = std::make_unique< typename TestFixture::T::BtreeType >(this->m_cfg);
+    this->m_bt->init(nullptr);
+    for (uint32_t i{0}; i < num_entries; i += 2) {
+        this->put(i, btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+    }
+
+    LOGINFO("Step 2: Read the first page of a serializable query, which keeps the leaves of its range locked");
+    const uint32_t start_k = num_entries / 2;
+    const uint32_t end_k = start_k + 8;
+    const uint32_t new_k = start_k + 5;
+    const auto expected_count = this->num_elems_in_range(start_k, end_k);
+    std::vector< std::pair< K, V > > out_vector;
+    BtreeQueryRequest< K > qreq{BtreeKeyRange< K >{K{start_k}, true, K{end_k}, true},
+                                BtreeQueryType::SERIALIZABLE_QUERY, 2};
+    ASSERT_EQ(this->m_bt->query(qreq, out_vector), btree_status_t::has_more);
+
+    LOGINFO("Step 3: Insert key {} within the range from another fiber, which should wait for the query", new_k);
+    bool inserted{false};
+    boost::fibers::fiber writer([this, new_k, &inserted]() {
+        this->put(new_k, btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+        inserted = true;
+    });
+    for (uint32_t i{0}; i < 10; ++i) {
+        boost::this_fiber::yield();
+    }
+    EXPECT_EQ(inserted, false) << "Insert into a leaf locked by serializable query did not wait for the query";
+
+    LOGINFO("Step 4: Read the remaining pages, which should not have the key being inserted");
+    btree_status_t ret;
+    do {
+        ret = this->m_bt->query(qreq, out_vector);
+    } while (ret == btree_status_t::has_more);
+    EXPECT_EQ(ret, btree_status_t::success);
+    EXPECT_EQ(out_vector.size(), expected_count) << "Serializable query results changed while it was in progress";
+    for (const auto& [k, v] : out_vector) {
+        EXPECT_NE(k.key(), new_k) << "Serializable query returned a key inserted after it started";
+    }
+
+    LOGINFO("Step 5: Query completion should let the insert through");
+    writer.join();
+    ASSERT_EQ(inserted, true);
+    this->get_specific_validate(new_k);
+    this->query_validate(start_k, end_k, 2, BtreeQueryType::SERIALIZABLE_QUERY);
+
+    LOGINFO("Step 6: Serializable query spanning more than 2 leaves should fail and leave no leaf locked");
+    ASSERT_GT(this->metric_value("Btree Leaf node count"), 2);
+    out_vector.clear();
+    {
+        BtreeQueryRequest< K > wide_qreq{BtreeKeyRange< K >{K{0}, true, K{num_entries - 1}, true},
+                                         BtreeQueryType::SERIALIZABLE_QUERY, 10};
+        ASSERT_EQ(this->m_bt->query(wide_qreq, out_vector), btree_status_t::not_supported);
+        ASSERT_EQ(out_vector.size(), 0);
+    }
+    for (uint32_t i{1}; i < num_entries; i += 2) {
+        if (i != new_k) { this->put(i, btree_put_type::INSERT_ONLY_IF_NOT_EXISTS); }
+    }
+    this->query_all_validate();
+}
+
+TYPED_TEST(BtreeTest, QueryRangeEnd) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do random insert of {} even keys", num_entries / 2);
+    std::vector< uint32_t > vec(num_entries / 2);
+    for (uint32_t i{0}; i < vec.size(); ++i) {
+        vec[i] = i * 2;
+    }
+    std::random_shuffle(vec.begin(), vec.end());
+    for (auto k : vec) {
+        this->put(k, btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+    }
+
+    LOGINFO("Step 2: Query ranges whose inclusive end key is absent");
+    this->query_end_validate(0, num_entries - 1, true /* end_incl */, UINT32_MAX);
+    this->query_end_validate(0, num_entries - 1, true /* end_incl */, 75);
+    this->query_end_validate(num_entries / 4, num_entries / 2 + 1, true /* end_incl */, 10);
+    this->query_end_validate(2, 3, true /* end_incl */, 5);
+
+    LOGINFO("Step 3: Query ranges whose exclusive end key is present");
+    this->query_end_validate(0, num_entries - 2, false /* end_incl */, UINT32_MAX);
+    this->query_end_validate(0, num_entries - 2, false /* end_incl */, 75);
+    this->query_end_validate(num_entries / 4, num_entries / 2 + 2, false /* end_incl */, 10);
+    this->query_end_validate(2, 4, false /* end_incl */, 5);
+}
+
+TYPED_TEST(BtreeTest, ReverseQuery) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    std::vector< uint32_t > vec(num_entries);
+    iota(vec.begin(), vec.end(), 0);
+    std::random_shuffle(vec.begin(), vec.end());
+    LOGINFO("Step 1: Do random insert for half of {} entries", num_entries);
+    for (uint32_t i{0}; i < num_entries; i += 2) {
+        this->put(vec[i], btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+    }
+
+    LOGINFO("Step 2: Reverse query all entries with pagination and validate");
+    this->reverse_query_validate(0, num_entries - 1, 75);
+
+    LOGINFO("Step 3: Reverse query sub ranges and validate");
+    this->reverse_query_validate(num_entries / 4, num_entries / 2, 10);
+    this->reverse_query_validate(num_entries / 3, num_entries / 3 + 5, UINT32_MAX);
+    this->reverse_query_validate(num_entries + 100, num_entries + 500, 5);
+}
+
+TYPED_TEST(BtreeTest, RedistributeBeforeSplit) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do forward sequential insert for half of {} entries with redistribution off", num_entries);
+    for (uint32_t i{0}; i < num_entries / 2; ++i) {
+        this->put(i, btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+    }
+    const auto num_nodes_without_redistribution = this->num_nodes();
+
+    LOGINFO("Step 2: Do the same insert on a new btree with redistribution on");
+    this->m_cfg.m_rebalance_turned_on = true;
+    this->m_bt = std::make_unique< typename TestFixture::T::BtreeType >(this->m_cfg);
+    this->m_bt->init(nullptr);
+    this->m_shadow_map.clear();
+    for (uint32_t i{0}; i < num_entries / 2; ++i) {
+        this->put(i, btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+    }
+    this->get_all_validate();
+    this->query_validate(0, num_entries / 2 - 1, 75);
+
+    // Ascending insert leaves every node it splits half full, which redistribution fills up instead
+    ASSERT_GT(this->metric_value("Total number of btree node redistributions"), 0)
+        << "Ascending insert is expected to redistribute entries to the left sibling";
+    ASSERT_LT(this->num_nodes(), num_nodes_without_redistribution)
+        << "Redistribution is expected to pack the ascending insert in fewer nodes than split alone";
+
+    LOGINFO("Step 3: Do random insert for the remaining entries");
+    std::vector< uint32_t > vec(num_entries - num_entries / 2);
+    iota(vec.begin(), vec.end(), num_entries / 2);
+    std::random_shuffle(vec.begin(), vec.end());
+    for (auto k : vec) {
+        this->put(k, btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+    }
+    this->get_all_validate();
+    this->query_all_paginate_validate(80);
+
+    LOGINFO("Step 4: Remove half of the entries and validate");
+    for (uint32_t k{0}; k < num_entries; k += 2) {
+        this->remove_one(k);
+    }
+    this->query_validate(0, num_entries - 1, 75);
+}
+
+TYPED_TEST(BtreeTest, NodeBufReuse) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    const auto& pool = this->m_bt->node_pool();
+
+    LOGINFO("Step 1: Do forward sequential insert for {} entries and remove all of them", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+    }
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->remove_one(i);
+    }
+    folly::rcu_barrier();
+    const auto capacity = pool.capacity();
+    LOGINFO("Node pool capacity={} available={} after removing all entries", capacity, pool.available());
+
+    LOGINFO("Step 2: Insert the same entries again and validate node buffers are reused from the pool");
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+    }
+    this->query_validate(0, num_entries - 1, 75);
+    ASSERT_EQ(pool.capacity(), capacity) << "Node pool grew while freed node buffers should have been reused";
+}
+
+TYPED_TEST(BtreeTest, OpProfiling) {
+    this->m_cfg.m_op_profile_sample_rate = 1;
+    this->m_bt = std::make_unique< typename TestFixture::T::BtreeType >(this->m_cfg);
+    this->m_bt->init(nullptr);
+
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    const uint32_t num_removes = num_entries * 3 / 4;
+    const uint32_t batch_size{75};
+    LOGINFO("Step 1: Do random insert, get and remove of {} entries with every operation profiled", num_entries);
+    std::vector< uint32_t > vec(num_entries);
+    iota(vec.begin(), vec.end(), 0);
+    std::random_shuffle(vec.begin(), vec.end());
+    for (auto k : vec) {
+        this->put(k, btree_put_type::INSERT_ONLY_IF_NOT_EXISTS);
+    }
+    this->get_all_validate();
+
+    // Removing a contiguous range empties the leaves and so merges them
+    for (uint32_t k{0}; k < num_removes; ++k) {
+        this->remove_one(k);
+    }
+    this->query_validate(0, num_entries - 1, batch_size);
+
+    LOGINFO("Step 2: Validate every operation is profiled and the phases are reported in metrics");
+    const uint64_t num_queries = (num_entries - num_removes + batch_size - 1) / batch_size;
+    const uint64_t num_ops = 2 * uint64_t{num_entries} + num_removes + num_queries;
+    ASSERT_EQ(this->metric_value("number of btree operations sampled for profiling"), double(num_ops))
+        << "Every operation is expected to be profiled with sample rate of 1";
+    ASSERT_GT(this->metric_value("Latency of the profiled operations"), 0);
+    ASSERT_GT(this->metric_value("Time profiled operations waited for node locks"), 0);
+    ASSERT_GT(this->metric_value("Time profiled operations spent reading nodes"), 0);
+    ASSERT_GT(this->metric_value("Time profiled operations spent writing nodes"), 0);
+    ASSERT_GT(this->metric_value("Time profiled operations spent splitting nodes"), 0);
+    if (this->m_cfg.m_merge_turned_on) {
+        ASSERT_GT(this->metric_value("Time profiled operations spent merging nodes"), 0);
+    }
+    ASSERT_GT(this->metric_value("Number of nodes visited by the profiled operations"), 0);
+}
+
 TYPED_TEST(BtreeTest, RangeUpdate) {
     // Forward sequential insert
     const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
@@ -901,6 +1450,92 @@ TYPED_TEST(BtreeConcurrentTest, AllTree) {
     this->execute(ops);
 }
 
+TEST(BtreeKeySearch, IntegralLowerBound) {
+    auto const validate = [](auto type_tag, uint32_t stride) {
+        using key_t = decltype(type_tag);
+        std::uniform_int_distribution< uint32_t > nentries_gen{0, 300};
+        std::uniform_int_distribution< uint64_t > key_gen{0, std::numeric_limits< key_t >::max()};
+
+        for (uint32_t iter{0}; iter < 200; ++iter) {
+            std::vector< key_t > keys(nentries_gen(g_re));
+            for (auto& k : keys) {
+                k = key_t(key_gen(g_re));
+            }
+            std::sort(keys.begin(), keys.end());
+            keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+            std::vector< uint8_t > buf(std::max(stride * keys.size(), size_t(1)));
+            for (size_t i{0}; i < keys.size(); ++i) {
+                std::memcpy(buf.data() + (stride * i), &keys[i], sizeof(key_t));
+            }
+
+            for (uint32_t q{0}; q < 50; ++q) {
+                key_t key = ((q % 2) && !keys.empty()) ? keys[key_gen(g_re) % keys.size()] : key_t(key_gen(g_re));
+                auto const expected = uint32_cast(std::lower_bound(keys.begin(), keys.end(), key) - keys.begin());
+                auto const [found, idx] =
+                    key_search::lower_bound< key_t >(buf.data(), stride, uint32_cast(keys.size()), key);
+                ASSERT_EQ(idx, expected) << "Mismatch on lower bound for nentries=" << keys.size();
+                ASSERT_EQ(found, (expected < keys.size()) && (keys[expected] == key));
+            }
+        }
+    };
+
+    validate(uint32_t{}, sizeof(uint32_t));
+    validate(uint32_t{}, sizeof(uint32_t) + BtreeLinkInfo::get_fixed_size());
+    validate(uint64_t{}, sizeof(uint64_t));
+    validate(uint64_t{}, sizeof(uint64_t) + BtreeLinkInfo::get_fixed_size());
+}
+
+// Exposes the btree lock tracking, to validate it is kept per fiber
+struct LockTrackingBtree : public MemBtree< TestFixedKey, TestFixedValue > {
+    using MemBtree< TestFixedKey, TestFixedValue >::MemBtree;
+    using Btree< TestFixedKey, TestFixedValue >::alloc_leaf_node;
+    using Btree< TestFixedKey, TestFixedValue >::free_node;
+    using Btree< TestFixedKey, TestFixedValue >::_start_of_lock;
+    using Btree< TestFixedKey, TestFixedValue >::remove_locked_node;
+};
+
+TEST(BtreeFiberVars, LockTrackingPerFiber) {
+    static constexpr uint32_t num_fibers{4};
+    static constexpr uint32_t nodes_per_fiber{3};
+
+    BtreeConfig cfg{g_node_size};
+    LockTrackingBtree bt{cfg};
+    bt.init(nullptr);
+
+    // Every fiber tracks its nodes as locked, yielding in between so that fibers interleave on this thread, and then
+    // removes them in the order they were locked. Lock tracking only looks at the last two nodes of the list, so
+    // removing the first node fails unless each fiber has its own list.
+    std::vector< boost::fibers::fiber > fibers;
+    for (uint32_t f{0}; f < num_fibers; ++f) {
+        fibers.emplace_back([&bt]() {
+            std::vector< BtreeNodePtr > nodes;
+            for (uint32_t i{0}; i < nodes_per_fiber; ++i) {
+                nodes.push_back(bt.alloc_leaf_node());
+                LockTrackingBtree::_start_of_lock(nodes.back(), locktype_t::WRITE, __FILE__, __LINE__);
+                boost::this_fiber::yield();
+            }
+            for (const auto& node : nodes) {
+                btree_locked_node_info info;
+                ASSERT_EQ(LockTrackingBtree::remove_locked_node(node, locktype_t::WRITE, &info), true)
+                    << "Node locked by this fiber is not tracked as locked by it";
+                ASSERT_EQ(info.node, node.get());
+                boost::this_fiber::yield();
+            }
+
+            btree_locked_node_info info;
+            ASSERT_EQ(LockTrackingBtree::remove_locked_node(nodes.front(), locktype_t::WRITE, &info), false)
+                << "Node is still tracked as locked after its removal";
+            for (const auto& node : nodes) {
+                bt.free_node(node, locktype_t::NONE, nullptr);
+            }
+        });
+    }
+    for (auto& fiber : fibers) {
+        fiber.join();
+    }
+}
+
 int main(int argc, char* argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
     SISL_OPTIONS_LOAD(argc, argv, logging, test_mem_btree)